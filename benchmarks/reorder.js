@@ -0,0 +1,130 @@
+// Author: Carlos Peña-Monferrer (SIMZERO) - 2023
+
+// Times the grid operations of the ML class for each cell and point
+// reordering method on a sample mesh, after building the module with
+// `make all`.
+//
+// Usage:
+//   node benchmarks/reorder.js <mesh.vtu> [repeats] [x,y,z] [size]
+//
+// The point x,y,z, inside the mesh, is used as the probe location, the
+// origin of the cutting plane (normal along z) and the center of the
+// streamline seeds. It defaults to 0,0,0. The size, 1 by default, is a
+// length scale of the mesh used for the streamline seeds and propagation.
+
+const fs = require('fs');
+const { performance } = require('perf_hooks');
+const jsfluids = require('../dist/index.js');
+
+const methods = ['none', 'morton', 'rcm'];
+
+const median = (values) => {
+  const sorted = values.slice().sort((a, b) => a - b);
+  const middle = Math.floor(sorted.length / 2);
+
+  return sorted.length % 2 ?
+    sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+};
+
+// The setup, if any, runs untimed before each repeat
+const time = async (repeats, operation, setup) => {
+  const times = [];
+
+  for (let i = 0; i < repeats; i++) {
+    if (setup) {
+      await setup();
+    }
+
+    const start = performance.now();
+    operation();
+    times.push(performance.now() - start);
+  }
+
+  return median(times);
+};
+
+(async () => {
+  const [meshFile, repeatsArg, pointArg, sizeArg] = process.argv.slice(2);
+
+  if (!meshFile) {
+    console.error('Usage: node benchmarks/reorder.js <mesh.vtu> [repeats]'
+      + ' [x,y,z] [size]');
+    process.exit(1);
+  }
+
+  const repeats = repeatsArg ? parseInt(repeatsArg) : 10;
+  const point = pointArg ? pointArg.split(',').map(Number) : [0, 0, 0];
+  const size = sizeArg ? Number(sizeArg) : 1;
+  const mesh = fs.readFileSync(meshFile);
+
+  await jsfluids.ready;
+  const model = jsfluids.ML;
+  const results = [];
+  let cuts = 0;
+
+  for (const method of methods) {
+    let U;
+
+    // Loads the mesh and sets the same field, so that every repeat starts
+    // from the same grid arrays
+    const load = async () => {
+      await model.loadMesh(mesh, { reorder: method });
+      model.setOperations({ operations: [] });
+
+      if (!U || U.length !== 3 * model.nCells) {
+        U = new Float64Array(3 * model.nCells);
+        for (let i = 0; i < U.length; i++) {
+          U[i] = Math.random();
+        }
+      }
+
+      model.update({ field: 'U', data: U });
+    };
+
+    const loadTimes = [];
+    for (let i = 0; i < repeats; i++) {
+      const start = performance.now();
+      await model.loadMesh(mesh, { reorder: method });
+      loadTimes.push(performance.now() - start);
+    }
+
+    await load();
+
+    results.push({
+      method: method,
+      cells: model.nCells,
+      'load (ms)': median(loadTimes),
+      'cell to point (ms)': await time(repeats, () => {
+        model.update({ field: 'U', data: U });
+      }),
+      'probe (ms)': await time(repeats, () => {
+        model.probe({ field: 'U', point: point });
+      }),
+      // Includes writing the VTP. The origin is shifted slightly on each
+      // repeat so that the cutter runs again.
+      'cut (ms)': await time(repeats, () => {
+        cuts++;
+        model.ml.plane(point[0], point[1], point[2] + 1e-9 * cuts, 0, 0, 1);
+      }),
+      // Includes writing the VTP of the tubes
+      'streams (ms)': await time(repeats, () => {
+        model.ml.streams(point[0], point[1], point[2], 0.05 * size, size,
+          0.005 * size, 8, 8, 'U');
+      }),
+      // Gradients add arrays to the grid, so it is loaded again before each
+      // repeat to time the same workload
+      'gradients (ms)': await time(repeats, () => {
+        model.ml.gradients(false, true);
+      }, load)
+    });
+  }
+
+  console.table(results.map((result) => {
+    const row = {};
+    for (const [key, value] of Object.entries(result)) {
+      row[key] = typeof value === 'number' && !Number.isInteger(value) ?
+        Number(value.toFixed(2)) : value;
+    }
+    return row;
+  }));
+})();
@@ -5,7 +5,7 @@ echo "#############################"
 echo  BUILDING fluids.js
 echo "#############################"
 
-ROOT=/build
+ROOT=${ROOT:-/build}
 
 BUILD_ROOT=$ROOT/thirdparty
 VTK_ROOT=$BUILD_ROOT/vtk
@@ -22,6 +22,8 @@ SPLINTER_BUILD=$SPLINTER_ROOT/splinter-wasm
 ROMJS_ROOT=$BUILD_ROOT/rom-js
 ROMJS_INCLUDE=$ROMJS_ROOT/src
 ITHACA_ROMPROBLEMS=$BUILD_ROOT_ROMJS/ithaca-fv/src/ITHACA_ROMPROBLEMS
+ONNXRUNTIME_ROOT=$BUILD_ROOT/onnxruntime
+ONNXRUNTIME_BUILD=$ONNXRUNTIME_ROOT/build/Linux/Release
 
 if [ ! -d ./build  ];then
   mkdir -p ./build
@@ -142,9 +144,24 @@ EMSCRIPTEN_OPTIONS="
   --bind \
 "
 
+ML_OPTIONS=""
+
+if [[ "$WITH_ONNXRUNTIME" = "true" ]]; then
+  # This is the optional in-process inference backend for the ML class
+  ML_OPTIONS="
+    -DWITH_ONNXRUNTIME \
+    -I $ONNXRUNTIME_ROOT/include/onnxruntime/core/session \
+    -L $ONNXRUNTIME_BUILD \
+    -lonnxruntime_webassembly \
+  "
+else
+  echo "Building without ONNX Runtime"
+fi
+
 # Code splitting for dynamic loads
 emcc \
   $VTK_OPTIONS \
+  $ML_OPTIONS \
   $EMSCRIPTEN_OPTIONS \
   -o ./build/ml.js \
   ./src/ML.cc
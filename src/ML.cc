@@ -14,5 +14,16 @@ EMSCRIPTEN_BINDINGS(Module)
         .function("fieldScalar", &ML::fieldScalar)
         .function("update", &ML::update)
         .function("computeSDFAndRegion", &ML::computeSDFAndRegion)
+        .function("updateSDFAndRegion", &ML::updateSDFAndRegion)
+        .function("setImageGrid", &ML::setImageGrid)
+        .function("clearImageGrid", &ML::clearImageGrid)
+        .function("imageSDFAndRegion", &ML::imageSDFAndRegion)
+        .function("imageField", &ML::imageField)
+        .function("imageToMesh", &ML::imageToMesh)
+        .function("imageVoxels", &ML::imageVoxels)
+#ifdef WITH_ONNXRUNTIME
+        .function("loadModel", &ML::loadModel)
+        .function("predictAndUpdate", &ML::predictAndUpdate)
+#endif
 	;
 }
@@ -11,10 +11,14 @@
 #include <vector>
 
 #include <VTK.cc>
+#include <resample.h>
 
-#include <vtkCellCenters.h> 
 #include <vtkImplicitPolyDataDistance.h>
 
+#ifdef WITH_ONNXRUNTIME
+#include "ONNX.h"
+#endif
+
 
 using namespace std;
 
@@ -23,6 +27,15 @@ class ML : public VTK {
     ML() {}
 
     emscripten::val fieldVector() {
+      if (singlePrecision) {
+        return emscripten::val(
+          emscripten::typed_memory_view(
+            3*nCells,
+            fieldVectorVectorFloat.data()
+          )
+        );
+      }
+
       return emscripten::val(
         emscripten::typed_memory_view(
           3*nCells,
@@ -32,6 +45,15 @@ class ML : public VTK {
     }
 
     emscripten::val fieldScalar() {
+      if (singlePrecision) {
+        return emscripten::val(
+          emscripten::typed_memory_view(
+            nCells,
+            fieldVectorVectorFloat.data()
+          )
+        );
+      }
+
       return emscripten::val(
         emscripten::typed_memory_view(
           nCells,
@@ -41,30 +63,16 @@ class ML : public VTK {
     }
 
     auto update(string fieldName, int components) {
-      vtkNew<vtkDoubleArray> array;
-      array->SetName(fieldName.c_str());
-      array->SetNumberOfComponents(components);
-      array->SetNumberOfTuples(fieldVectorVector.size() / components);
+      vtkSmartPointer<vtkDataArray> array;
 
-      for( vtkIdType i = 0; i < nCells; i++ )
-      {
-        if (components == 3) {
-          array->SetTuple3(
-            i,
-            fieldVectorVector[i],
-            fieldVectorVector[i + nCells],
-            fieldVectorVector[i + 2*nCells]
-          );
-        }
-        if (components == 1) {
-          array->SetTuple1(
-            i,
-            fieldVectorVector[i]
-          );
-        }
+      if (singlePrecision) {
+        array = fieldToArray<vtkFloatArray>(fieldVectorVectorFloat, components);
+      }
+      else {
+        array = fieldToArray<vtkDoubleArray>(fieldVectorVector, components);
       }
 
-      // velocity->SetArray(UVector.data(), UVector.size(), 0);
+      array->SetName(fieldName.c_str());
 
       grid->GetCellData()->AddArray(array);
 
@@ -78,6 +86,349 @@ class ML : public VTK {
     }
 
     auto computeSDFAndRegion(string const& buffer) {
+      updateSDFAndRegion(buffer);
+
+      if (singlePrecision) {
+        return typedArray(inputVectorFloat, "Float32Array");
+      }
+
+      return typedArray(inputVector, "Float64Array");
+    }
+
+    // Same as computeSDFAndRegion, keeping the result in the model input
+    // buffer without copying it out
+    void updateSDFAndRegion(string const& buffer) {
+      if (singlePrecision) {
+        sdfAndRegion<vtkFloatArray>(buffer, inputVectorFloat);
+      }
+      else {
+        sdfAndRegion<vtkDoubleArray>(buffer, inputVector);
+      }
+    }
+
+    // Builds the operators between the grid and a regular image used by
+    // grid-based models. Returns the number of voxels, or 0 for invalid
+    // dimensions, which leave the previous image grid as is.
+    int setImageGrid(double originX, double originY, double originZ,
+      double spacingX, double spacingY, double spacingZ,
+      int dimX, int dimY, int dimZ) {
+      if (dimX < 1 || dimY < 1 || dimZ < 1) {
+        return 0;
+      }
+
+      double origin[3] = {originX, originY, originZ};
+      double spacing[3] = {spacingX, spacingY, spacingZ};
+      int dims[3] = {dimX, dimY, dimZ};
+
+      resample.build(grid, cellOrder.empty() ? nullptr : cellOrder.data(),
+        centers().data(), origin, spacing, dims);
+
+      return resample.nVoxels;
+    }
+
+    // Removes the image grid, so that predictions take mesh inputs again
+    void clearImageGrid() {
+      resample.clear();
+    }
+
+    // The last SDF1, flowRegion and SDF2 fields resampled on the image, or
+    // null without an image grid or computed fields
+    emscripten::val imageSDFAndRegion() {
+      if (singlePrecision) {
+        if (!meshToImage(inputVectorFloat, imageInputVectorFloat)) {
+          return emscripten::val::null();
+        }
+        return typedArray(imageInputVectorFloat, "Float32Array");
+      }
+
+      if (!meshToImage(inputVector, imageInputVector)) {
+        return emscripten::val::null();
+      }
+      return typedArray(imageInputVector, "Float64Array");
+    }
+
+    // View of the image field buffer to be filled before imageToMesh
+    emscripten::val imageField(int components) {
+      size_t size = components * resample.nVoxels;
+
+      if (singlePrecision) {
+        imageOutputVectorFloat.resize(size);
+        return emscripten::val(
+          emscripten::typed_memory_view(size, imageOutputVectorFloat.data()));
+      }
+
+      imageOutputVector.resize(size);
+      return emscripten::val(
+        emscripten::typed_memory_view(size, imageOutputVector.data()));
+    }
+
+    // Resamples the image field buffer on the grid cells and updates the
+    // grid. Returns false if the buffer was not sized by imageField for the
+    // given components.
+    bool imageToMesh(string fieldName, int components) {
+      size_t imageSize = singlePrecision ?
+        imageOutputVectorFloat.size() : imageOutputVector.size();
+
+      if (!resample.built() || resample.nCells != nCells ||
+        (components != 1 && components != 3) ||
+        imageSize != components * static_cast<size_t>(resample.nVoxels)) {
+        return false;
+      }
+
+      if (singlePrecision) {
+        resample.toMesh(imageOutputVectorFloat.data(),
+          fieldVectorVectorFloat.data(), components);
+      }
+      else {
+        resample.toMesh(imageOutputVector.data(),
+          fieldVectorVector.data(), components);
+      }
+
+      update(fieldName, components);
+
+      return true;
+    }
+
+#ifdef WITH_ONNXRUNTIME
+    // Loads a float32 ONNX model taking the SDF and region fields as input
+    bool loadModel(string const& buffer) {
+      return onnx.load(buffer);
+    }
+
+    // Runs the loaded model on the last SDF and region fields, writes the
+    // prediction into the field buffer and updates the grid. With an image
+    // grid set, the model runs on the resampled image. Returns the number of
+    // components of the predicted field, or 0 on failure.
+    int predictAndUpdate(string fieldName) {
+      size_t inputSize = singlePrecision ?
+        inputVectorFloat.size() : inputVector.size();
+      size_t points = nCells;
+      vector<int64_t> extent = {nCells};
+
+      if (resample.built()) {
+        inputSize = inputSize > 0 ? 3*resample.nVoxels : 0;
+        points = resample.nVoxels;
+        extent = {resample.dims[2], resample.dims[1], resample.dims[0]};
+      }
+
+      if (!onnx.loaded() || inputSize == 0 || !onnx.resize(extent, inputSize)) {
+        return 0;
+      }
+
+      int components = 0;
+
+      if (onnx.outputSize() == 3*points) {
+        components = 3;
+      }
+      else if (onnx.outputSize() == points) {
+        components = 1;
+      }
+      else {
+        return 0;
+      }
+
+      if (singlePrecision) {
+        float* input = inputVectorFloat.data();
+        float* output = fieldVectorVectorFloat.data();
+
+        if (resample.built()) {
+          if (!meshToImage(inputVectorFloat, imageInputVectorFloat)) {
+            return 0;
+          }
+          imageOutputVectorFloat.resize(onnx.outputSize());
+          input = imageInputVectorFloat.data();
+          output = imageOutputVectorFloat.data();
+        }
+
+        if (!onnx.run(input, output)) {
+          return 0;
+        }
+
+        if (resample.built()) {
+          resample.toMesh(output, fieldVectorVectorFloat.data(), components);
+        }
+      }
+      else {
+        vector<double>& input = resample.built() ? imageInputVector : inputVector;
+
+        if (resample.built() && !meshToImage(inputVector, imageInputVector)) {
+          return 0;
+        }
+
+        inferenceInput.assign(input.begin(), input.end());
+        inferenceOutput.resize(onnx.outputSize());
+
+        if (!onnx.run(inferenceInput.data(), inferenceOutput.data())) {
+          return 0;
+        }
+
+        if (resample.built()) {
+          imageOutputVector.assign(inferenceOutput.begin(), inferenceOutput.end());
+          resample.toMesh(imageOutputVector.data(), fieldVectorVector.data(),
+            components);
+        }
+        else {
+          std::copy(inferenceOutput.begin(), inferenceOutput.end(),
+            fieldVectorVector.begin());
+        }
+      }
+
+      update(fieldName, components);
+
+      return components;
+    }
+#endif
+
+    #include "common.h"
+
+
+    virtual string stlToVtp(string const& buffer) {
+      return VTK::stlToVtp(buffer);
+    }
+
+    // Number of voxels of the image grid, or 0 if there is none for the
+    // loaded mesh
+    int imageVoxels() {
+      return resample.built() && resample.nCells == nCells ?
+        resample.nVoxels : 0;
+    }
+
+  protected:
+    // Scalar fields share the vector field buffer, see fieldScalar. Called
+    // for every new mesh, so the image operators of the previous one are
+    // dropped too. readState restores them afterwards.
+    virtual void allocateFields() {
+      VTK::allocateFields();
+      vector<double>().swap(fieldScalarVector);
+      resample.clear();
+    }
+
+    virtual string stateProducer() {
+      return "ML";
+    }
+
+    // Adds the image grid operators to the prepared state
+    virtual void writeState(StateWriter& writer) {
+      VTK::writeState(writer);
+
+      if (!resample.built()) {
+        return;
+      }
+
+      vector<double> image = {
+        resample.origin[0], resample.origin[1], resample.origin[2],
+        resample.spacing[0], resample.spacing[1], resample.spacing[2],
+        static_cast<double>(resample.dims[0]),
+        static_cast<double>(resample.dims[1]),
+        static_cast<double>(resample.dims[2])
+      };
+
+      writer.add("RIMG", image, VTK_DOUBLE);
+      writer.add("RIOF", resample.toImageOffsets, VTK_ID_TYPE);
+      writer.add("RICO", resample.toImageColumns, VTK_ID_TYPE);
+      writer.add("RIWE", resample.toImageWeights, VTK_FLOAT);
+      writer.add("RMOF", resample.toMeshOffsets, VTK_ID_TYPE);
+      writer.add("RMCO", resample.toMeshColumns, VTK_ID_TYPE);
+      writer.add("RMWE", resample.toMeshWeights, VTK_FLOAT);
+    }
+
+    virtual bool readState(StateReader const& reader) {
+      if (!VTK::readState(reader)) {
+        return false;
+      }
+
+      resample.clear();
+      vector<double> image;
+
+      if (!reader.read("RIMG", image) || image.size() != 9) {
+        return true;
+      }
+
+      for (int k = 0; k < 3; ++k) {
+        resample.origin[k] = image[k];
+        resample.spacing[k] = image[3 + k];
+        resample.dims[k] = static_cast<int>(image[6 + k]);
+      }
+
+      reader.view("RIOF", resample.toImageOffsets);
+      reader.view("RICO", resample.toImageColumns);
+      reader.view("RIWE", resample.toImageWeights);
+      reader.view("RMOF", resample.toMeshOffsets);
+      reader.view("RMCO", resample.toMeshColumns);
+      reader.view("RMWE", resample.toMeshWeights);
+
+      vtkIdType nVoxels = static_cast<vtkIdType>(resample.dims[0]) *
+        resample.dims[1] * resample.dims[2];
+
+      if (resample.toImageOffsets.size() == static_cast<size_t>(nVoxels + 1) &&
+        resample.toMeshOffsets.size() == static_cast<size_t>(nCells + 1)) {
+        resample.nCells = nCells;
+        resample.nVoxels = nVoxels;
+      }
+      else {
+        resample.clear();
+      }
+
+      return true;
+    }
+
+  private:
+    // The field buffers are stored by component, i.e. [x0..xn, y0..yn, z0..zn],
+    // and in the original cell order of the mesh
+    template <typename ArrayType, typename ValueType>
+    vtkSmartPointer<ArrayType> fieldToArray(vector<ValueType> const& field,
+      int components) {
+      vtkSmartPointer<ArrayType> array = vtkSmartPointer<ArrayType>::New();
+      array->SetNumberOfComponents(components);
+      array->SetNumberOfTuples(nCells);
+
+      ValueType* data = array->GetPointer(0);
+      const vtkIdType* order = cellOrder.empty() ? nullptr : cellOrder.data();
+
+      for (vtkIdType i = 0; i < nCells; i++)
+      {
+        vtkIdType source = order ? order[i] : i;
+
+        for (int c = 0; c < components; c++)
+        {
+          data[i*components + c] = field[source + c*nCells];
+        }
+      }
+
+      return array;
+    }
+
+    template <typename ValueType>
+    static emscripten::val typedArray(vector<ValueType> const& data,
+      const char* type) {
+      emscripten::val view {
+        emscripten::typed_memory_view(
+          data.size(),
+          data.data()
+        )
+      };
+      auto result = emscripten::val::global(type).new_(data.size());
+      result.call<void>("set", view);
+
+      return result;
+    }
+
+    // False without an image grid for the current mesh or computed fields
+    template <typename ValueType>
+    bool meshToImage(vector<ValueType> const& mesh, vector<ValueType>& image) {
+      if (!resample.built() || resample.nCells != nCells ||
+        mesh.size() != 3*static_cast<size_t>(nCells)) {
+        return false;
+      }
+
+      image.resize(3*resample.nVoxels);
+      resample.toImage(mesh.data(), image.data(), 3);
+
+      return true;
+    }
+
+    template <typename ArrayType, typename ValueType>
+    void sdfAndRegion(string const& buffer, vector<ValueType>& output) {
       vtkNew<vtkXMLPolyDataReader> vtkReader;
       vtkReader->ReadFromInputStringOn();
       vtkReader->SetInputString(buffer);
@@ -86,7 +437,7 @@ class ML : public VTK {
       vtkNew<vtkImplicitPolyDataDistance> implicitPolyDataDistance;
       implicitPolyDataDistance->SetInput(vtkReader->GetOutput());
 
-      vtkNew<vtkDoubleArray> sdf1;
+      vtkNew<ArrayType> sdf1;
       sdf1->SetNumberOfComponents(1);
       sdf1->SetName("sdf1");
       sdf1->SetNumberOfTuples(nCells);
@@ -95,20 +446,20 @@ class ML : public VTK {
       vtkDataArray* sdf2Data = grid->GetCellData()->GetArray("sdf2");
 
       int nCellsOutput = grid->GetNumberOfCells();
-      vector<double> output(nCellsOutput * 3);
+      output.resize(nCellsOutput * 3);
 
-      vtkNew<vtkCellCenters> cellCentersFilter;
-      cellCentersFilter->SetInputData(grid);
-      cellCentersFilter->VertexCellsOn();
-      cellCentersFilter->Update();
+      const double* cellCenter = centers().data();
+      const vtkIdType* order = cellOrder.empty() ? nullptr : cellOrder.data();
 
       for (vtkIdType cellId = 0; cellId < nCellsOutput; ++cellId)
       {
+        vtkIdType target = order ? order[cellId] : cellId;
         double flowRegionValue = flowRegionData->GetTuple1(cellId);
         double sdf2RegionValue = sdf2Data->GetTuple1(cellId);
-        double p[3];
+        double p[3] = {
+          cellCenter[3*cellId], cellCenter[3*cellId + 1], cellCenter[3*cellId + 2]
+        };
 
-        cellCentersFilter->GetOutput()->GetPoint(cellId, p);
         double signedDistance = implicitPolyDataDistance->EvaluateFunction(p);
       
         if(signedDistance < 0)
@@ -116,33 +467,33 @@ class ML : public VTK {
           flowRegionValue = 0;
         }
         
-        sdf1->SetTuple1(cellId, signedDistance);
+        sdf1->SetValue(cellId, signedDistance);
 
-        output.at(cellId + nCellsOutput) = flowRegionValue;
-        output.at(cellId) = signedDistance;
-        output.at(cellId + nCellsOutput * 2) = sdf2RegionValue;
+        output.at(target + nCellsOutput) = flowRegionValue;
+        output.at(target) = signedDistance;
+        output.at(target + nCellsOutput * 2) = sdf2RegionValue;
       }
 
       grid->GetCellData()->SetScalars(sdf1);
-    
-      emscripten::val view {
-        emscripten::typed_memory_view(
-          output.size(),
-          output.data()
-        )
-      };
-      auto result = emscripten::val::global("Float64Array").new_(output.size());
-      result.call<void>("set", view);
-
-      return result;
     }
 
-    #include "common.h"
+    // SDF1, flowRegion and SDF2 by component, in the original cell order
+    vector<double> inputVector;
+    vector<float> inputVectorFloat;
 
+    Resample resample;
+    // Image buffers by channel, [c][z][y][x]
+    vector<double> imageInputVector;
+    vector<double> imageOutputVector;
+    vector<float> imageInputVectorFloat;
+    vector<float> imageOutputVectorFloat;
 
-    virtual string stlToVtp(string const& buffer) {
-      return VTK::stlToVtp(buffer);
-    }
+#ifdef WITH_ONNXRUNTIME
+    ONNX onnx;
+    // float32 staging buffers for the float64 storage mode
+    vector<float> inferenceInput;
+    vector<float> inferenceOutput;
+#endif
 };
 
 #endif // ML_H
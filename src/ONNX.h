@@ -0,0 +1,189 @@
+// Author: Carlos Peña-Monferrer (SIMZERO) - 2023
+
+#ifndef ONNX_H
+#define ONNX_H
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <onnxruntime_cxx_api.h>
+
+using namespace std;
+
+// Single input, single output float32 ONNX Runtime session running on the
+// CPU. Tensors are bound to caller-owned buffers, so inference reads and
+// writes them in place.
+class ONNX {
+
+public:
+  bool load(string const& buffer) {
+    try {
+      Ort::SessionOptions options;
+      options.SetIntraOpNumThreads(1);
+      options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+
+      session = std::make_unique<Ort::Session>(
+        env, buffer.data(), buffer.size(), options);
+
+      Ort::AllocatorWithDefaultOptions allocator;
+      inputName = session->GetInputNameAllocated(0, allocator).get();
+      outputName = session->GetOutputNameAllocated(0, allocator).get();
+      modelInputShape = session->GetInputTypeInfo(0)
+        .GetTensorTypeAndShapeInfo().GetShape();
+      modelOutputShape = session->GetOutputTypeInfo(0)
+        .GetTensorTypeAndShapeInfo().GetShape();
+    }
+    catch (Ort::Exception const&) {
+      session.reset();
+      return false;
+    }
+
+    inputShape.clear();
+    outputShape.clear();
+
+    return true;
+  }
+
+  // Resolves the dynamic dimensions of the model for an input of inputSize
+  // values with the given spatial extent, i.e. {nCells} for mesh buffers or
+  // {nz, ny, nx} for image buffers. The batch dimension is run with size
+  // one, and the other dynamic dimensions are matched to the trailing
+  // extents. A single dimension left is inferred from inputSize, and output
+  // dimensions dynamic in the input too take the same size. Returns false
+  // if the shapes cannot be resolved or do not match inputSize.
+  bool resize(vector<int64_t> const& extent, size_t inputSize) {
+    inputShape = resolve(modelInputShape, extent, inputSize);
+    vector<int64_t> output = modelOutputShape;
+
+    for (size_t i = 0; i < output.size() && i < inputShape.size(); ++i) {
+      if (output[i] < 0 && modelInputShape[i] < 0) {
+        output[i] = inputShape[i];
+      }
+    }
+
+    outputShape = resolve(output, extent, 0);
+
+    if (inputShape.empty() || outputShape.empty() ||
+      shapeSize(inputShape) != inputSize) {
+      inputShape.clear();
+      outputShape.clear();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool loaded() const {
+    return session != nullptr;
+  }
+
+  size_t inputSize() const {
+    return shapeSize(inputShape);
+  }
+
+  size_t outputSize() const {
+    return shapeSize(outputShape);
+  }
+
+  bool run(float* input, float* output) {
+    if (!session || inputShape.empty() || outputShape.empty()) {
+      return false;
+    }
+
+    try {
+      Ort::MemoryInfo memoryInfo =
+        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+
+      Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
+        memoryInfo, input, inputSize(), inputShape.data(), inputShape.size());
+      Ort::Value outputTensor = Ort::Value::CreateTensor<float>(
+        memoryInfo, output, outputSize(), outputShape.data(), outputShape.size());
+
+      const char* inputNames[] = { inputName.c_str() };
+      const char* outputNames[] = { outputName.c_str() };
+
+      session->Run(Ort::RunOptions{nullptr}, inputNames, &inputTensor, 1,
+        outputNames, &outputTensor, 1);
+    }
+    catch (Ort::Exception const&) {
+      return false;
+    }
+
+    return true;
+  }
+
+private:
+  // Empty if unresolved. Without a known size (0), a single dimension left
+  // cannot be inferred.
+  static vector<int64_t> resolve(vector<int64_t> shape,
+    vector<int64_t> const& extent, size_t size) {
+    if (shape.empty()) {
+      return shape;
+    }
+
+    if (shape[0] < 0) {
+      shape[0] = 1;
+    }
+
+    size_t offset = shape.size() > extent.size() ?
+      shape.size() - extent.size() : 0;
+
+    for (size_t i = std::max<size_t>(offset, 1); i < shape.size(); ++i) {
+      if (shape[i] < 0) {
+        shape[i] = extent[i - offset];
+      }
+    }
+
+    size_t known = 1;
+    int unknown = -1;
+
+    for (size_t i = 0; i < shape.size(); ++i) {
+      if (shape[i] >= 0) {
+        known *= shape[i];
+      }
+      else if (unknown < 0) {
+        unknown = i;
+      }
+      else {
+        return {};
+      }
+    }
+
+    if (unknown >= 0) {
+      if (size == 0 || known == 0 || size % known != 0) {
+        return {};
+      }
+      shape[unknown] = size / known;
+    }
+
+    return shape;
+  }
+
+  static size_t shapeSize(vector<int64_t> const& shape) {
+    if (shape.empty()) {
+      return 0;
+    }
+
+    size_t size = 1;
+    for (auto dim : shape) {
+      size *= dim;
+    }
+
+    return size;
+  }
+
+  Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "jsfluids"};
+  std::unique_ptr<Ort::Session> session;
+  string inputName;
+  string outputName;
+  // As exported, with -1 for dynamic dimensions
+  vector<int64_t> modelInputShape;
+  vector<int64_t> modelOutputShape;
+  // Resolved by resize
+  vector<int64_t> inputShape;
+  vector<int64_t> outputShape;
+};
+
+#endif // ONNX_H
@@ -8,18 +8,32 @@ using namespace emscripten;
 EMSCRIPTEN_BINDINGS(Module_VTK) {
     class_<VTK>("VTK")
         .constructor<>()
+        .function("advectParticles", &VTK::advectParticles)
+        .function("blendFields", &VTK::blendFields)
+        .function("cacheFields", &VTK::cacheFields)
+        .function("exportData", &VTK::exportData)
+        .function("exportState", &VTK::exportState)
         .function("exportUnstructuredGrid", &VTK::exportUnstructuredGrid)
         .function("gradients", &VTK::gradients)
         .function("integrate", &VTK::integrate)
         .function("exporter", &VTK::exporter)
+        .function("particlePositions", &VTK::particlePositions)
         .function("probe", &VTK::probe)
         .function("initScene", &VTK::initScene)
         .function("geometry", &VTK::geometry)
         .function("plane", &VTK::plane)
         .function("readUnstructuredGrid", &VTK::readUnstructuredGrid)
         .function("removeAllActors", &VTK::removeAllActors)
+        .function("removeFields", &VTK::removeFields)
         .function("render", &VTK::render)
+        .function("restoreFields", &VTK::restoreFields)
+        .function("restoreState", &VTK::restoreState)
         .function("scalarBarRange", &VTK::scalarBarRange)
+        .function("seedParticles", &VTK::seedParticles)
+        .function("setExportOptions", &VTK::setExportOptions)
+        .function("setPrecision", &VTK::setPrecision)
+        .function("setReordering", &VTK::setReordering)
+        .function("stateBuffer", &VTK::stateBuffer)
 	.function("stlToVtp", &VTK::stlToVtp)
         .function("streams", &VTK::streams)
         .function("unstructuredGridToPolyData", &VTK::unstructuredGridToPolyData)
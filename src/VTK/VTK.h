@@ -7,19 +7,24 @@
 #include <string>
 #include <fstream>
 #include <sstream>
-#include <list>
+#include <map>
+#include <memory>
 #include <vector>
 
 #include <emscripten.h>
 #include <emscripten/bind.h>
 
 #include <vtkActor.h>
+#include <vtkCellCenters.h>
 #include <vtkCellData.h>
 #include <vtkCellDataToPointData.h>
 #include <vtkCutter.h>
 #include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
 #include <vtkGeometryFilter.h>
 #include <vtkGradientFilter.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
 #include <vtkOBJExporter.h>
 #include <vtkGLTFExporter.h>
 #include <vtkImageData.h>
@@ -40,12 +45,18 @@
 #include <vtkSphereSource.h>
 #include <vtkStreamTracer.h>
 #include <vtkSTLReader.h>
+#include <vtkStringArray.h>
 #include <vtkTubeFilter.h>
 #include <vtkUnstructuredGrid.h>
 #include <vtkXMLPolyDataReader.h>
 #include <vtkXMLPolyDataWriter.h>
 #include <vtkXMLUnstructuredGridReader.h>
 #include <vtkXMLUnstructuredGridWriter.h>
+#include <vtkXMLWriter.h>
+
+#include "particles.h"
+#include "reorder.h"
+#include "state.h"
 
 using namespace std;
 
@@ -84,7 +95,9 @@ public:
     vtkNew<vtkXMLPolyDataWriter> polyDataXMLWriter;
     polyDataXMLWriter->SetInputData(stlReader->GetOutput());
     polyDataXMLWriter->WriteToOutputStringOn();
-    polyDataXMLWriter->SetDataModeToAscii();
+    // Base64 inline data keeps the string text-safe without the cost of
+    // formatting and parsing every coordinate as ASCII.
+    polyDataXMLWriter->SetDataModeToBinary();
     polyDataXMLWriter->Update();
     polyDataXMLWriter->Write();
 
@@ -99,14 +112,110 @@ public:
     reader->SetInputString(buffer);
     reader->Update();
 
-    grid->DeepCopy(reader->GetOutput());
+    vtkUnstructuredGrid* input = reader->GetOutput();
+
+    if (reorderMethod == "morton" || reorderMethod == "rcm") {
+      vector<vtkIdType> cells = reorderMethod == "rcm" ?
+        Reorder::rcm(input) : Reorder::morton(input);
+      vector<vtkIdType> points = Reorder::points(input, cells);
+      grid = Reorder::apply(input, cells, points);
+      cellInverse = Reorder::inverse(cells);
+      pointInverse = Reorder::inverse(points);
+      cellOrder = std::move(cells);
+      pointOrder = std::move(points);
+      gridReordering = reorderMethod;
+    }
+    else {
+      cellOrder.clear();
+      pointOrder.clear();
+      cellInverse.clear();
+      pointInverse.clear();
+      gridReordering = "none";
+      grid->DeepCopy(input);
+    }
+
     nCells = grid->GetNumberOfCells();
-    fieldVectorVector.resize(3*nCells);
-    fieldScalarVector.resize(nCells);
+    meshTopologyHashes.clear();
+    boundary = nullptr;
+    surfacePointIds = nullptr;
+    cellCenters.clear();
+
+    if (singlePrecision) {
+      toSinglePrecision(grid);
+    }
+
+    allocateFields();
 
     return nCells;
   }
 
+  // Serializes the prepared mesh state, i.e. the grid with its arrays, the
+  // reordering, the cell centers and the boundary surface, as a versioned
+  // and checksummed byte array to be stored by the application.
+  emscripten::val exportState() {
+    centers();
+    boundarySurface();
+
+    StateWriter writer;
+    writeState(writer);
+
+    return toUint8Array(writer.finish());
+  }
+
+  // Buffer of the given size for a state written by exportState, to be
+  // filled from JS before calling restoreState
+  emscripten::val stateBuffer(int size) {
+    pendingState = std::make_shared<string>(std::max(size, 0), '\0');
+
+    return emscripten::val(
+      emscripten::typed_memory_view(
+        pendingState->size(),
+        reinterpret_cast<unsigned char*>(&(*pendingState)[0])
+      )
+    );
+  }
+
+  // Restores the state in stateBuffer in place: the grid arrays, the
+  // reordering, the cell centers and the boundary surface point into it
+  // instead of being rebuilt, so it is kept until the next restored state.
+  // Locators are built again on first use. Returns the number of cells, or
+  // 0 for an invalid or outdated state.
+  virtual int restoreState() {
+    std::shared_ptr<string> blob;
+    blob.swap(pendingState);
+
+    StateReader reader;
+
+    if (!blob || !reader.parse(*blob) || !readState(reader)) {
+      return 0;
+    }
+
+    // Filters keep their last input, which may point into the previous state
+    cutter->SetInputData(grid);
+    streamer->SetInputData(grid);
+    geometryFilter->SetInputData(grid);
+    polydata = vtkSmartPointer<vtkPolyData>::New();
+    polyDataMapper->SetInputData(polydata);
+
+    stateBlob.swap(blob);
+
+    return nCells;
+  }
+
+  // Selects the memory layout of the grid loaded by readUnstructuredGrid:
+  // "none", "morton" (space-filling curve) or "rcm" (reverse Cuthill-McKee).
+  // The field buffers stay in the original cell order, while the grid
+  // points, cells and arrays are permuted.
+  virtual void setReordering(string method) {
+    reorderMethod = method;
+  }
+
+  // Selects the storage of the field buffers and grid arrays, "float32" or
+  // "float64". Must be called before readUnstructuredGrid.
+  virtual void setPrecision(string precision) {
+    singlePrecision = precision == "float32";
+  }
+
   virtual string plane(float originX, float originY, float originZ,
     float normalX, float normalY, float normalZ) {
     dynPlane->SetOrigin(originX, originY, originZ);
@@ -126,12 +235,8 @@ public:
   }
 
   virtual string unstructuredGridToPolyData() {
-    vtkNew<vtkGeometryFilter> geometryFilter;
-    geometryFilter->SetInputData(grid);
-    geometryFilter->Update();
-
     vtkNew<vtkXMLPolyDataWriter> writer;
-    writer->SetInputConnection(geometryFilter->GetOutputPort());
+    writer->SetInputData(surface());
     writer->WriteToOutputStringOn();
     writer->Write();
     std::string binary_string = writer->GetOutputString();
@@ -147,11 +252,293 @@ public:
     return unstructuredGridWriter->GetOutputString();
   }
 
-  virtual void geometry() {
-    geometryFilter->SetInputData(grid);
-    geometryFilter->Update();
+  virtual void setExportOptions(string dataMode, string compressor, int level) {
+    if (dataMode == "ascii") {
+      exportDataMode = vtkXMLWriter::Ascii;
+    }
+    else if (dataMode == "binary") {
+      exportDataMode = vtkXMLWriter::Binary;
+    }
+    else {
+      exportDataMode = vtkXMLWriter::Appended;
+    }
+
+    if (compressor == "none") {
+      exportCompressor = vtkXMLWriter::NONE;
+    }
+    else if (compressor == "lz4") {
+      exportCompressor = vtkXMLWriter::LZ4;
+    }
+    else if (compressor == "lzma") {
+      exportCompressor = vtkXMLWriter::LZMA;
+    }
+    else {
+      exportCompressor = vtkXMLWriter::ZLIB;
+    }
 
-    polydata = geometryFilter->GetOutput();
+    exportCompressionLevel = level;
+  }
+
+  // Writes the target ("grid", "surface" or "component") as a VTU/VTP byte
+  // array with the options set in setExportOptions. With delta enabled and
+  // an unchanged topology since the last delta export of the same target,
+  // only the arrays whose contents changed are written, as field data of an
+  // empty VTP named "PointData:<name>" or "CellData:<name>". Arrays are only
+  // hashed for delta exports, so the first one writes the full file.
+  emscripten::val exportData(string target, bool delta) {
+    vtkSmartPointer<vtkDataSet> dataSet;
+
+    if (target == "grid") {
+      dataSet = grid;
+    }
+    else if (target == "surface") {
+      dataSet = surface();
+    }
+    else if (target == "component") {
+      dataSet = polydata;
+    }
+    else {
+      return emscripten::val::null();
+    }
+
+    if (!delta) {
+      // Full exports are not hashed, the next delta export starts over
+      exportTopologyHashes.erase(target);
+      exportFieldHashes.erase(target);
+
+      return writeDataSet(dataSet);
+    }
+
+    // The grid and surface topologies only change with the mesh, so their
+    // hashes are kept until the next one is loaded. Components are cut or
+    // traced again on each change, so they are always hashed.
+    uint64_t topology;
+    auto cachedTopology = meshTopologyHashes.find(target);
+
+    if (cachedTopology != meshTopologyHashes.end()) {
+      topology = cachedTopology->second;
+    }
+    else {
+      topology = topologyHash(dataSet);
+
+      if (target != "component") {
+        meshTopologyHashes[target] = topology;
+      }
+    }
+
+    bool sameTopology = exportTopologyHashes.count(target) &&
+      exportTopologyHashes[target] == topology;
+    exportTopologyHashes[target] = topology;
+
+    map<string, uint64_t> previousHashes;
+    previousHashes.swap(exportFieldHashes[target]);
+    map<string, uint64_t>& hashes = exportFieldHashes[target];
+
+    vtkNew<vtkPolyData> deltaData;
+    vtkFieldData* deltaFields = deltaData->GetFieldData();
+
+    vtkFieldData* attributes[2] = {
+      dataSet->GetPointData(), dataSet->GetCellData()
+    };
+    string prefixes[2] = { "PointData:", "CellData:" };
+
+    for (int a = 0; a < 2; ++a) {
+      for (int i = 0; i < attributes[a]->GetNumberOfArrays(); ++i) {
+        vtkDataArray* array = attributes[a]->GetArray(i);
+
+        if (!array || !array->GetName()) {
+          continue;
+        }
+
+        string key = prefixes[a] + array->GetName();
+        uint64_t hash = hashArray(array);
+        hashes[key] = hash;
+
+        auto previous = previousHashes.find(key);
+        bool changed = previous == previousHashes.end() ||
+          previous->second != hash;
+
+        if (previous != previousHashes.end()) {
+          previousHashes.erase(previous);
+        }
+
+        if (changed && sameTopology) {
+          vtkSmartPointer<vtkDataArray> changedArray =
+            vtkSmartPointer<vtkDataArray>::Take(array->NewInstance());
+          changedArray->ShallowCopy(array);
+          changedArray->SetName(key.c_str());
+          deltaFields->AddArray(changedArray);
+        }
+      }
+    }
+
+    if (!sameTopology) {
+      return writeDataSet(dataSet);
+    }
+
+    // Arrays present in the previous export but gone now
+    if (!previousHashes.empty()) {
+      vtkNew<vtkStringArray> removed;
+      removed->SetName("RemovedArrays");
+      for (auto const& previous : previousHashes) {
+        removed->InsertNextValue(previous.first);
+      }
+      deltaFields->AddArray(removed);
+    }
+
+    vtkNew<vtkXMLPolyDataWriter> writer;
+    writer->SetInputData(deltaData);
+
+    return writeBytes(writer);
+  }
+
+  // Snapshots of the grid fields, e.g. to memoize solutions by parameters
+  virtual void cacheFields(int slot) {
+    auto& fields = fieldCache[slot];
+    fields.first = vtkSmartPointer<vtkPointData>::New();
+    fields.first->DeepCopy(grid->GetPointData());
+    fields.second = vtkSmartPointer<vtkCellData>::New();
+    fields.second->DeepCopy(grid->GetCellData());
+  }
+
+  virtual bool restoreFields(int slot) {
+    auto cached = fieldCache.find(slot);
+
+    if (cached == fieldCache.end()) {
+      return false;
+    }
+
+    grid->GetPointData()->DeepCopy(cached->second.first);
+    grid->GetCellData()->DeepCopy(cached->second.second);
+
+    return true;
+  }
+
+  virtual void removeFields(int slot) {
+    fieldCache.erase(slot);
+  }
+
+  // Sets the floating point fields of the grid to the weighted sum of the
+  // given snapshots. The other arrays are taken from the first snapshot.
+  virtual bool blendFields(emscripten::val slots, emscripten::val weights) {
+    vector<int> slotIds = emscripten::vecFromJSArray<int>(slots);
+    vector<double> slotWeights = emscripten::vecFromJSArray<double>(weights);
+
+    if (slotIds.empty() || slotIds.size() != slotWeights.size()) {
+      return false;
+    }
+
+    for (int slot : slotIds) {
+      if (!fieldCache.count(slot)) {
+        return false;
+      }
+    }
+
+    restoreFields(slotIds[0]);
+
+    vtkFieldData* attributes[2] = {
+      grid->GetPointData(), grid->GetCellData()
+    };
+
+    for (int a = 0; a < 2; ++a) {
+      vtkFieldData* fields = attributes[a];
+
+      for (int i = 0; i < fields->GetNumberOfArrays(); ++i) {
+        vtkDataArray* array = fields->GetArray(i);
+
+        if (!array || !array->GetName()) {
+          continue;
+        }
+
+        int type = array->GetDataType();
+        if (type != VTK_DOUBLE && type != VTK_FLOAT) {
+          continue;
+        }
+
+        vtkIdType size = array->GetNumberOfValues();
+
+        for (size_t k = 0; k < slotIds.size(); ++k) {
+          auto& cached = fieldCache[slotIds[k]];
+          vtkFieldData* source = a == 0 ?
+            static_cast<vtkFieldData*>(cached.first) :
+            static_cast<vtkFieldData*>(cached.second);
+          vtkDataArray* sourceArray = source->GetArray(array->GetName());
+
+          if (!sourceArray || sourceArray->GetDataType() != type ||
+            sourceArray->GetNumberOfValues() != size) {
+            continue;
+          }
+
+          if (type == VTK_DOUBLE) {
+            accumulate(static_cast<double*>(array->GetVoidPointer(0)),
+              static_cast<double*>(sourceArray->GetVoidPointer(0)),
+              size, slotWeights[k], k == 0);
+          }
+          else {
+            accumulate(static_cast<float*>(array->GetVoidPointer(0)),
+              static_cast<float*>(sourceArray->GetVoidPointer(0)),
+              size, slotWeights[k], k == 0);
+          }
+        }
+
+        array->Modified();
+      }
+    }
+
+    return true;
+  }
+
+  // Seeds tracer particles in a sphere, see advectParticles. Returns false
+  // for a negative count or a non-positive radius or lifetime.
+  virtual bool seedParticles(int count, float centerX, float centerY,
+    float centerZ, double radius, double lifetime) {
+    if (count < 0 || !(radius > 0) || !(lifetime > 0)) {
+      return false;
+    }
+
+    if (!particles.hasMesh(grid)) {
+      particles.setMesh(grid);
+    }
+
+    double center[3] = {centerX, centerY, centerZ};
+    particles.seed(count, center, radius, lifetime);
+
+    return true;
+  }
+
+  // Advances the particles a time step through the given velocity field and
+  // returns a view of their positions. The buffer is reused across steps.
+  // Returns null, without moving the particles, for an unknown field or one
+  // without 3 components.
+  emscripten::val advectParticles(double dt, string field) {
+    bool pointVelocity = true;
+    vtkDataArray* velocity = grid->GetPointData()->GetArray(field.c_str());
+
+    if (!velocity) {
+      velocity = grid->GetCellData()->GetArray(field.c_str());
+      pointVelocity = false;
+    }
+
+    if (!velocity || velocity->GetNumberOfComponents() != 3) {
+      return emscripten::val::null();
+    }
+
+    particles.advance(velocity, pointVelocity, dt);
+
+    return particlePositions();
+  }
+
+  emscripten::val particlePositions() {
+    return emscripten::val(
+      emscripten::typed_memory_view(
+        particles.positions.size(),
+        particles.positions.data()
+      )
+    );
+  }
+
+  virtual void geometry() {
+    polydata = surface();
   }
 
   virtual void gradients(bool doVorticity, bool doGradients) {
@@ -364,9 +751,7 @@ public:
     colorLookupTable->SetHueRange(0.667, 0.0);
 
     if (component == "surface") {
-        geometryFilter->SetInputData(grid);
-        geometryFilter->Update();
-        polydata = geometryFilter->GetOutput();
+        polydata = surface();
     } else if (component == "plane") {
         cutter->SetInputData(grid);
         cutter->Update();
@@ -413,10 +798,11 @@ public:
 
     unsigned char *dataPointer = polyDataMapper->GetColorMapColors()->GetPointer(0);
     int dataSize = polyDataMapper->GetColorMapColors()->GetNumberOfTuples() * actor->GetMapper()->GetColorMapColors()->GetNumberOfComponents();
-    std::vector<double> data(dataPointer, dataPointer + dataSize);
+    std::vector<float> data(dataSize);
 
-    std::transform(data.begin(), data.end(), data.begin(), [](double value) {
-        return value / 255.0;
+    std::transform(dataPointer, dataPointer + dataSize, data.begin(),
+      [](unsigned char value) {
+        return value / 255.0f;
     });
 
     emscripten::val view {
@@ -483,8 +869,39 @@ public:
   };
 
   int nCells;
+  int exportDataMode = vtkXMLWriter::Appended;
+  int exportCompressor = vtkXMLWriter::ZLIB;
+  int exportCompressionLevel = 5;
+  map<string, uint64_t> exportTopologyHashes;
+  // Topology hashes of the grid and surface targets for the loaded mesh
+  map<string, uint64_t> meshTopologyHashes;
+  map<string, map<string, uint64_t>> exportFieldHashes;
+  bool singlePrecision = false;
+  string reorderMethod = "none";
+  // Reordering of the loaded grid, as reorderMethod may change afterwards
+  string gridReordering = "none";
+  // New to old (order) and old to new (inverse) ids, empty if not reordered
+  StateArray<vtkIdType> cellOrder;
+  StateArray<vtkIdType> cellInverse;
+  StateArray<vtkIdType> pointOrder;
+  StateArray<vtkIdType> pointInverse;
+  map<int, pair<vtkSmartPointer<vtkPointData>, vtkSmartPointer<vtkCellData>>>
+    fieldCache;
+  Particles particles;
+  // Boundary surface topology with the original point and cell ids, and cell
+  // centers as x,y,z triplets, both in grid order and built on first use
+  vtkSmartPointer<vtkPolyData> boundary;
+  StateArray<double> cellCenters;
+  // Original ids of the boundary surface points and cells, see surface
+  vtkSmartPointer<vtkIdList> surfacePointIds;
+  vtkSmartPointer<vtkIdList> surfaceCellIds;
+  // Restored state, which the restored arrays point into, and the buffer
+  // for the next one. Shared so that copies of the instance stay valid.
+  std::shared_ptr<string> stateBlob;
+  std::shared_ptr<string> pendingState;
   vector<double> fieldVectorVector;
   vector<double> fieldScalarVector;
+  vector<float> fieldVectorVectorFloat;
   vtkSmartPointer<vtkUnstructuredGrid> grid =
     vtkSmartPointer<vtkUnstructuredGrid>::New();
   vtkSmartPointer<vtkXMLUnstructuredGridWriter> unstructuredGridWriter =
@@ -516,7 +933,442 @@ public:
   vtkSmartPointer<vtkRenderer> renderer =
     vtkSmartPointer<vtkRenderer>::New();
 
+protected:
+  // Cell centers of the grid, computed once per mesh
+  StateArray<double> const& centers() {
+    vtkIdType nGridCells = grid->GetNumberOfCells();
+
+    if (cellCenters.size() != 3*static_cast<size_t>(nGridCells)) {
+      vtkNew<vtkCellCenters> cellCentersFilter;
+      cellCentersFilter->SetInputData(grid);
+      cellCentersFilter->VertexCellsOn();
+      cellCentersFilter->Update();
+
+      vtkPolyData* output = cellCentersFilter->GetOutput();
+      vector<double> gridCenters(3*nGridCells, 0);
+
+      for (vtkIdType cellId = 0;
+        cellId < std::min(nGridCells, output->GetNumberOfPoints()); ++cellId) {
+        output->GetPoint(cellId, &gridCenters[3*cellId]);
+      }
+
+      cellCenters = std::move(gridCenters);
+    }
+
+    return cellCenters;
+  }
+
+  // Boundary surface of the grid topology, extracted once per mesh
+  vtkPolyData* boundarySurface() {
+    if (!boundary) {
+      vtkNew<vtkUnstructuredGrid> structure;
+      structure->CopyStructure(grid);
+
+      vtkNew<vtkGeometryFilter> boundaryFilter;
+      boundaryFilter->SetInputData(structure);
+      boundaryFilter->PassThroughPointIdsOn();
+      boundaryFilter->PassThroughCellIdsOn();
+      boundaryFilter->Update();
+
+      boundary = boundaryFilter->GetOutput();
+      surfacePointIds = nullptr;
+    }
+
+    return boundary;
+  }
+
+  // Boundary surface with the current grid fields, gathered in bulk through
+  // the original ids instead of extracting the surface again. Each call
+  // returns a new polydata with its own arrays, sharing only the topology.
+  vtkSmartPointer<vtkPolyData> surface() {
+    vtkPolyData* topology = boundarySurface();
+
+    if (!surfacePointIds || !surfaceCellIds) {
+      vtkIdTypeArray* pointIds = vtkIdTypeArray::SafeDownCast(
+        topology->GetPointData()->GetArray("vtkOriginalPointIds"));
+      vtkIdTypeArray* cellIds = vtkIdTypeArray::SafeDownCast(
+        topology->GetCellData()->GetArray("vtkOriginalCellIds"));
+
+      if (!pointIds || !cellIds) {
+        geometryFilter->SetInputData(grid);
+        geometryFilter->Update();
+        return geometryFilter->GetOutput();
+      }
+
+      surfacePointIds = toIdList(pointIds);
+      surfaceCellIds = toIdList(cellIds);
+    }
+
+    vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+    output->CopyStructure(topology);
+    gatherArrays(grid->GetPointData(), output->GetPointData(),
+      surfacePointIds);
+    gatherArrays(grid->GetCellData(), output->GetCellData(),
+      surfaceCellIds);
+
+    return output;
+  }
+
+  // Class written in the state header. Subclasses with their own state
+  // sections return their own name.
+  virtual string stateProducer() {
+    return "VTK";
+  }
+
+  // Sections written by exportState. Subclasses add their own prepared
+  // state, and skip sections they do not know when reading.
+  virtual void writeState(StateWriter& writer) {
+    vector<vtkIdType> head = {
+      singlePrecision ? 1 : 0, reorderingCode(gridReordering), nCells
+    };
+    writer.add("HEAD", stateProducer(), VTK_ID_TYPE, 1, head.size(),
+      head.data(), head.size() * sizeof(vtkIdType));
+
+    if (grid->GetPoints()) {
+      writer.add("GPTS", "", grid->GetPoints()->GetData());
+    }
+    writer.add("GOFF", "GCON", grid->GetCells());
+    writer.add("GTYP", "", grid->GetCellTypesArray());
+    writer.add("GFLO", "", grid->GetFaceLocations());
+    writer.add("GFAC", "", grid->GetFaces());
+    writer.add("GPDA", grid->GetPointData());
+    writer.add("GCDA", grid->GetCellData());
+
+    writer.add("CORD", cellOrder, VTK_ID_TYPE);
+    writer.add("CINV", cellInverse, VTK_ID_TYPE);
+    writer.add("PORD", pointOrder, VTK_ID_TYPE);
+    writer.add("PINV", pointInverse, VTK_ID_TYPE);
+    writer.add("CCEN", cellCenters, VTK_DOUBLE);
+
+    if (boundary && boundary->GetPoints()) {
+      writer.add("BPTS", "", boundary->GetPoints()->GetData());
+      writer.add("BVOF", "BVCN", boundary->GetVerts());
+      writer.add("BLOF", "BLCN", boundary->GetLines());
+      writer.add("BPOF", "BPCN", boundary->GetPolys());
+      writer.add("BSOF", "BSCN", boundary->GetStrips());
+      writer.add("BPDA", boundary->GetPointData());
+      writer.add("BCDA", boundary->GetCellData());
+    }
+  }
+
+  // States written by another class, or with another precision or
+  // reordering than the selected ones, are rejected, as their fields and
+  // permutations would be misread
+  virtual bool readState(StateReader const& reader) {
+    vector<vtkIdType> head;
+
+    if (!reader.read("HEAD", head, stateProducer()) || head.size() < 3 ||
+      head[0] != (singlePrecision ? 1 : 0) ||
+      head[1] != reorderingCode(reorderMethod)) {
+      return false;
+    }
+
+    vtkSmartPointer<vtkDataArray> pointsData = reader.array("GPTS");
+    vtkSmartPointer<vtkCellArray> cells = reader.cells("GOFF", "GCON");
+    vtkSmartPointer<vtkUnsignedCharArray> types =
+      vtkUnsignedCharArray::SafeDownCast(reader.array("GTYP"));
+
+    if (!pointsData ||
+      pointsData->GetNumberOfComponents() != 3 || !cells || !types ||
+      types->GetNumberOfTuples() != cells->GetNumberOfCells()) {
+      return false;
+    }
+
+    vtkSmartPointer<vtkUnstructuredGrid> restored =
+      vtkSmartPointer<vtkUnstructuredGrid>::New();
+
+    vtkNew<vtkPoints> points;
+    points->SetData(pointsData);
+    restored->SetPoints(points);
+
+    vtkSmartPointer<vtkIdTypeArray> faceLocations =
+      vtkIdTypeArray::SafeDownCast(reader.array("GFLO"));
+    vtkSmartPointer<vtkIdTypeArray> faces =
+      vtkIdTypeArray::SafeDownCast(reader.array("GFAC"));
+
+    if (faceLocations && faces) {
+      restored->SetCells(types, cells, faceLocations, faces);
+    }
+    else {
+      restored->SetCells(types, cells);
+    }
+
+    reader.fields("GPDA", restored->GetPointData());
+    reader.fields("GCDA", restored->GetCellData());
+
+    grid = restored;
+    nCells = head[2];
+    gridReordering = head[1] != 0 ? reorderMethod : "none";
+
+    reader.view("CORD", cellOrder);
+    reader.view("CINV", cellInverse);
+    reader.view("PORD", pointOrder);
+    reader.view("PINV", pointInverse);
+    reader.view("CCEN", cellCenters);
+
+    boundary = nullptr;
+    surfacePointIds = nullptr;
+    vtkSmartPointer<vtkDataArray> boundaryPoints = reader.array("BPTS");
+
+    if (boundaryPoints && boundaryPoints->GetNumberOfComponents() == 3) {
+      boundary = vtkSmartPointer<vtkPolyData>::New();
+
+      vtkNew<vtkPoints> surfacePoints;
+      surfacePoints->SetData(boundaryPoints);
+      boundary->SetPoints(surfacePoints);
+
+      if (auto verts = reader.cells("BVOF", "BVCN")) {
+        boundary->SetVerts(verts);
+      }
+      if (auto lines = reader.cells("BLOF", "BLCN")) {
+        boundary->SetLines(lines);
+      }
+      if (auto polys = reader.cells("BPOF", "BPCN")) {
+        boundary->SetPolys(polys);
+      }
+      if (auto strips = reader.cells("BSOF", "BSCN")) {
+        boundary->SetStrips(strips);
+      }
+
+      reader.fields("BPDA", boundary->GetPointData());
+      reader.fields("BCDA", boundary->GetCellData());
+    }
+
+    particles = Particles();
+    fieldCache.clear();
+    exportTopologyHashes.clear();
+    exportFieldHashes.clear();
+    meshTopologyHashes.clear();
+    allocateFields();
+
+    return true;
+  }
+
+  // Sizes the field buffers for the current precision. The scalar buffer is
+  // only kept in float64 storage, where subclasses may fill it.
+  virtual void allocateFields() {
+    if (singlePrecision) {
+      vector<double>().swap(fieldVectorVector);
+      vector<double>().swap(fieldScalarVector);
+      fieldVectorVectorFloat.resize(3*nCells);
+    }
+    else {
+      vector<float>().swap(fieldVectorVectorFloat);
+      fieldVectorVector.resize(3*nCells);
+      fieldScalarVector.resize(nCells);
+    }
+  }
+
 private:
+
+  template <typename ValueType>
+  static void accumulate(ValueType* target, const ValueType* source,
+    vtkIdType size, double weight, bool first) {
+    for (vtkIdType i = 0; i < size; ++i) {
+      target[i] = (first ? 0 : target[i]) + weight * source[i];
+    }
+  }
+
+  // Narrows the double points and point/cell arrays of the grid to float
+  static void toSinglePrecision(vtkUnstructuredGrid* dataSet) {
+    vtkPoints* points = dataSet->GetPoints();
+
+    if (points && points->GetDataType() == VTK_DOUBLE) {
+      vtkNew<vtkPoints> floatPoints;
+      floatPoints->SetDataTypeToFloat();
+      floatPoints->GetData()->DeepCopy(points->GetData());
+      dataSet->SetPoints(floatPoints);
+    }
+
+    vtkFieldData* attributes[2] = {
+      dataSet->GetPointData(), dataSet->GetCellData()
+    };
+
+    for (vtkFieldData* fields : attributes) {
+      for (int i = 0; i < fields->GetNumberOfArrays(); ++i) {
+        vtkDoubleArray* array = vtkDoubleArray::SafeDownCast(fields->GetArray(i));
+
+        if (!array) {
+          continue;
+        }
+
+        vtkNew<vtkFloatArray> floatArray;
+        floatArray->DeepCopy(array);
+        floatArray->SetName(array->GetName());
+        fields->AddArray(floatArray);
+      }
+    }
+  }
+
+  emscripten::val writeDataSet(vtkDataSet* dataSet) {
+    vtkSmartPointer<vtkXMLWriter> writer;
+
+    if (vtkUnstructuredGrid::SafeDownCast(dataSet)) {
+      writer = vtkSmartPointer<vtkXMLUnstructuredGridWriter>::New();
+    }
+    else {
+      writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+    }
+
+    writer->SetInputDataObject(dataSet);
+
+    return writeBytes(writer);
+  }
+
+  emscripten::val writeBytes(vtkXMLWriter* writer) {
+    writer->SetDataMode(exportDataMode);
+    writer->SetCompressorType(exportCompressor);
+    writer->SetCompressionLevel(exportCompressionLevel);
+    writer->SetHeaderTypeToUInt64();
+    writer->EncodeAppendedDataOff();
+    writer->WriteToOutputStringOn();
+    writer->Write();
+
+    return toUint8Array(writer->GetOutputString());
+  }
+
+  static emscripten::val toUint8Array(string const& output) {
+    emscripten::val view {
+      emscripten::typed_memory_view(
+        output.size(),
+        reinterpret_cast<const unsigned char*>(output.data())
+      )
+    };
+
+    auto result = emscripten::val::global("Uint8Array").new_(output.size());
+    result.call<void>("set", view);
+
+    return result;
+  }
+
+  // Code of a reordering method in the state header
+  static int reorderingCode(string const& method) {
+    return method == "morton" ? 1 : method == "rcm" ? 2 : 0;
+  }
+
+  static vtkSmartPointer<vtkIdList> toIdList(vtkIdTypeArray* ids) {
+    vtkSmartPointer<vtkIdList> list = vtkSmartPointer<vtkIdList>::New();
+    vtkIdType nIds = ids->GetNumberOfTuples();
+    list->SetNumberOfIds(nIds);
+    std::copy(ids->GetPointer(0), ids->GetPointer(0) + nIds,
+      list->GetPointer(0));
+
+    return list;
+  }
+
+  // Adds the source arrays to the target with the tuples at the given ids,
+  // copied in bulk per array
+  static void gatherArrays(vtkDataSetAttributes* source,
+    vtkDataSetAttributes* target, vtkIdList* ids) {
+    for (int i = 0; i < source->GetNumberOfArrays(); ++i) {
+      vtkAbstractArray* sourceArray = source->GetAbstractArray(i);
+
+      if (!sourceArray || !sourceArray->GetName()) {
+        continue;
+      }
+
+      vtkSmartPointer<vtkAbstractArray> array =
+        vtkSmartPointer<vtkAbstractArray>::Take(sourceArray->NewInstance());
+      array->SetName(sourceArray->GetName());
+      array->SetNumberOfComponents(sourceArray->GetNumberOfComponents());
+      array->SetNumberOfTuples(ids->GetNumberOfIds());
+      sourceArray->GetTuples(ids, array);
+      target->AddArray(array);
+    }
+
+    vtkDataArray* scalars = source->GetScalars();
+    if (scalars && scalars->GetName()) {
+      target->SetActiveScalars(scalars->GetName());
+    }
+
+    vtkDataArray* vectors = source->GetVectors();
+    if (vectors && vectors->GetName()) {
+      target->SetActiveVectors(vectors->GetName());
+    }
+  }
+
+  // FNV-1a over the raw array values, a word at a time. Arrays without the
+  // standard memory layout, e.g. implicit ones, are hashed by value instead
+  // of through GetVoidPointer, which would copy them.
+  static uint64_t hashArray(vtkDataArray* array,
+    uint64_t hash = 14695981039346656037ULL) {
+    if (!array || array->GetNumberOfValues() == 0) {
+      return hash;
+    }
+
+    if (!array->HasStandardMemoryLayout()) {
+      vtkIdType nTuples = array->GetNumberOfTuples();
+      int nComponents = array->GetNumberOfComponents();
+
+      for (vtkIdType tupleId = 0; tupleId < nTuples; ++tupleId) {
+        for (int c = 0; c < nComponents; ++c) {
+          double value = array->GetComponent(tupleId, c);
+          uint64_t word;
+          std::memcpy(&word, &value, 8);
+          hash ^= word;
+          hash *= 1099511628211ULL;
+        }
+      }
+
+      return hash;
+    }
+
+    const char* bytes = static_cast<const char*>(array->GetVoidPointer(0));
+    size_t size = static_cast<size_t>(array->GetNumberOfValues()) *
+      array->GetDataTypeSize();
+    size_t words = size / 8;
+
+    for (size_t i = 0; i < words; ++i) {
+      uint64_t word;
+      std::memcpy(&word, bytes + 8*i, 8);
+      hash ^= word;
+      hash *= 1099511628211ULL;
+    }
+
+    for (size_t i = 8*words; i < size; ++i) {
+      hash ^= static_cast<unsigned char>(bytes[i]);
+      hash *= 1099511628211ULL;
+    }
+
+    return hash;
+  }
+
+  static uint64_t topologyHash(vtkDataSet* dataSet) {
+    uint64_t hash = 14695981039346656037ULL;
+    hash ^= static_cast<uint64_t>(dataSet->GetNumberOfPoints());
+    hash *= 1099511628211ULL;
+    hash ^= static_cast<uint64_t>(dataSet->GetNumberOfCells());
+    hash *= 1099511628211ULL;
+
+    if (auto pointSet = vtkPointSet::SafeDownCast(dataSet)) {
+      if (pointSet->GetPoints()) {
+        hash = hashArray(pointSet->GetPoints()->GetData(), hash);
+      }
+    }
+
+    if (auto unstructuredGrid = vtkUnstructuredGrid::SafeDownCast(dataSet)) {
+      if (unstructuredGrid->GetCells()) {
+        hash = hashArray(unstructuredGrid->GetCells()->GetOffsetsArray(), hash);
+        hash = hashArray(
+          unstructuredGrid->GetCells()->GetConnectivityArray(), hash);
+        hash = hashArray(unstructuredGrid->GetCellTypesArray(), hash);
+      }
+    }
+    else if (auto polyData = vtkPolyData::SafeDownCast(dataSet)) {
+      vtkCellArray* cellArrays[4] = {
+        polyData->GetVerts(), polyData->GetLines(),
+        polyData->GetPolys(), polyData->GetStrips()
+      };
+      for (vtkCellArray* cells : cellArrays) {
+        if (cells) {
+          hash = hashArray(cells->GetOffsetsArray(), hash);
+          hash = hashArray(cells->GetConnectivityArray(), hash);
+        }
+      }
+    }
+
+    return hash;
+  }
 };
 
 #endif // VTK_H
@@ -2,6 +2,18 @@
 
 #ifndef COMMON_H
 #define COMMON_H
+  emscripten::val advectParticles(double dt, string field) {
+    return VTK::advectParticles(dt, field);
+  }
+
+  virtual bool blendFields(emscripten::val slots, emscripten::val weights) {
+    return VTK::blendFields(slots, weights);
+  }
+
+  virtual void cacheFields(int slot) {
+    return VTK::cacheFields(slot);
+  }
+
   virtual string exporter() {
     return VTK::exporter();
   }
@@ -10,6 +22,14 @@
     return VTK::exportUnstructuredGrid();
   }
 
+  emscripten::val exportData(string target, bool delta) {
+    return VTK::exportData(target, delta);
+  }
+
+  emscripten::val exportState() {
+    return VTK::exportState();
+  }
+
   virtual void geometry() {
     return VTK::geometry();
   }
@@ -35,11 +55,48 @@
     return VTK::removeAllActors();
   }
 
+  virtual void removeFields(int slot) {
+    return VTK::removeFields(slot);
+  }
+
+  virtual bool restoreFields(int slot) {
+    return VTK::restoreFields(slot);
+  }
+
+  virtual int restoreState() {
+    return VTK::restoreState();
+  }
+
+  virtual bool seedParticles(int count, float centerX, float centerY,
+    float centerZ, double radius, double lifetime) {
+    return VTK::seedParticles(count, centerX, centerY, centerZ, radius, lifetime);
+  }
+
+  virtual void setExportOptions(string dataMode, string compressor, int level) {
+    return VTK::setExportOptions(dataMode, compressor, level);
+  }
+
+  virtual void setPrecision(string precision) {
+    return VTK::setPrecision(precision);
+  }
+
+  virtual void setReordering(string method) {
+    return VTK::setReordering(method);
+  }
+
+  emscripten::val stateBuffer(int size) {
+    return VTK::stateBuffer(size);
+  }
+
   // double integrate(string field, string type) {
   emscripten::val integrate(string field, string type) {
     return VTK::integrate(field, type);
   }
 
+  emscripten::val particlePositions() {
+    return VTK::particlePositions();
+  }
+
   emscripten::val probe(string field, float pointX, float pointY, float pointZ) {
     return VTK::probe(field, pointX, pointY, pointZ);
   }
@@ -0,0 +1,302 @@
+// Author: Carlos Peña-Monferrer (SIMZERO) - 2023
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <vtkDataArray.h>
+#include <vtkGenericCell.h>
+#include <vtkIdList.h>
+#include <vtkSmartPointer.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+#include <vtkStaticCellLocator.h>
+#include <vtkUnstructuredGrid.h>
+
+using namespace std;
+
+// Tracer particles advected through a velocity field. Each particle keeps
+// the cell containing it, and is relocated every step by walking through
+// the face neighbors from that cell instead of a global search.
+class Particles {
+
+public:
+  // Shares the grid topology and builds the cell links and the locator used
+  // for seeding. Cell ids must not change afterwards.
+  void setMesh(vtkUnstructuredGrid* grid) {
+    mesh = vtkSmartPointer<vtkUnstructuredGrid>::New();
+    mesh->CopyStructure(grid);
+    mesh->BuildLinks();
+
+    locator = vtkSmartPointer<vtkStaticCellLocator>::New();
+    locator->SetDataSet(mesh);
+    locator->BuildLocator();
+
+    maxCellSize = mesh->GetMaxCellSize();
+  }
+
+  bool hasMesh(vtkUnstructuredGrid* grid) const {
+    return mesh && mesh->GetNumberOfCells() == grid->GetNumberOfCells() &&
+      mesh->GetNumberOfPoints() == grid->GetNumberOfPoints();
+  }
+
+  // Seeds count particles uniformly in a sphere. Particles are respawned in
+  // the sphere when they leave the grid or their lifetime expires.
+  // Lifetimes are randomized between half and the full given lifetime.
+  void seed(int count, const double seedCenter[3], double seedRadius,
+    double seedLifetime) {
+    for (int k = 0; k < 3; ++k) {
+      center[k] = seedCenter[k];
+    }
+    radius = seedRadius;
+    lifetime = seedLifetime;
+
+    points.assign(3*count, 0);
+    positions.assign(3*count, 0);
+    cells.assign(count, -1);
+    ages.assign(count, 0);
+    lifetimes.assign(count, lifetime);
+    random.resize(count);
+
+    for (int i = 0; i < count; ++i) {
+      random[i] = 2654435761u * (i + 1);
+    }
+
+    vtkSMPTools::For(0, count, [&](vtkIdType begin, vtkIdType end) {
+      Scratch& scratch = localScratch();
+      for (vtkIdType i = begin; i < end; ++i) {
+        respawn(i, scratch);
+        // Spread the initial ages to avoid respawning all at once
+        ages[i] = lifetimes[i] * uniform(random[i]);
+      }
+    });
+  }
+
+  // Advances the particles one time step with the midpoint method. The
+  // velocity is interpolated from point data, or taken per cell otherwise.
+  void advance(vtkDataArray* velocity, bool pointVelocity, double dt) {
+    if (!mesh || !velocity) {
+      return;
+    }
+
+    vtkIdType count = cells.size();
+
+    vtkSMPTools::For(0, count, [&](vtkIdType begin, vtkIdType end) {
+      Scratch& scratch = localScratch();
+
+      for (vtkIdType i = begin; i < end; ++i) {
+        double* x = &points[3*i];
+        ages[i] += dt;
+
+        if (cells[i] < 0 || ages[i] > lifetimes[i]) {
+          respawn(i, scratch);
+          continue;
+        }
+
+        double u[3];
+        double midpoint[3];
+        double target[3];
+
+        if (!interpolate(velocity, pointVelocity, cells[i], x, u, scratch)) {
+          respawn(i, scratch);
+          continue;
+        }
+
+        for (int k = 0; k < 3; ++k) {
+          midpoint[k] = x[k] + 0.5 * dt * u[k];
+        }
+
+        vtkIdType midpointCell = walk(cells[i], midpoint, scratch);
+
+        if (midpointCell < 0 ||
+          !interpolate(velocity, pointVelocity, midpointCell, midpoint, u, scratch)) {
+          respawn(i, scratch);
+          continue;
+        }
+
+        for (int k = 0; k < 3; ++k) {
+          target[k] = x[k] + dt * u[k];
+        }
+
+        vtkIdType cellId = walk(midpointCell, target, scratch);
+
+        if (cellId < 0) {
+          respawn(i, scratch);
+          continue;
+        }
+
+        cells[i] = cellId;
+        for (int k = 0; k < 3; ++k) {
+          x[k] = target[k];
+          positions[3*i + k] = static_cast<float>(target[k]);
+        }
+      }
+    });
+  }
+
+  // Particle positions as x,y,z triplets, kept across steps
+  vector<float> positions;
+
+private:
+  // Per thread, allocated on first use
+  struct Scratch {
+    vtkSmartPointer<vtkGenericCell> cell;
+    vtkSmartPointer<vtkIdList> facePoints;
+    vtkSmartPointer<vtkIdList> neighbors;
+    vector<double> weights;
+  };
+
+  Scratch& localScratch() {
+    Scratch& scratch = scratches->Local();
+
+    if (!scratch.cell) {
+      scratch.cell = vtkSmartPointer<vtkGenericCell>::New();
+      scratch.facePoints = vtkSmartPointer<vtkIdList>::New();
+      scratch.neighbors = vtkSmartPointer<vtkIdList>::New();
+    }
+
+    scratch.weights.resize(std::max(maxCellSize, 8));
+
+    return scratch;
+  }
+
+  // Finds the cell containing x starting from cellId, crossing the cell face
+  // closest to x at each step. Returns -1 if x is outside the grid.
+  vtkIdType walk(vtkIdType cellId, double x[3], Scratch& scratch) {
+    double closest[3];
+    double pcoords[3];
+    double dist2;
+    int subId;
+
+    for (int step = 0; step < maxWalk; ++step) {
+      mesh->GetCell(cellId, scratch.cell);
+      int inside = scratch.cell->EvaluatePosition(
+        x, closest, subId, pcoords, dist2, scratch.weights.data());
+
+      if (inside == 1) {
+        return cellId;
+      }
+
+      if (inside < 0) {
+        break;
+      }
+
+      if (!scratch.cell->CellBoundary(subId, pcoords, scratch.facePoints) ||
+        scratch.facePoints->GetNumberOfIds() == 0) {
+        break;
+      }
+
+      mesh->GetCellNeighbors(cellId, scratch.facePoints, scratch.neighbors);
+
+      if (scratch.neighbors->GetNumberOfIds() == 0) {
+        return -1;
+      }
+
+      cellId = scratch.neighbors->GetId(0);
+    }
+
+    // Long jumps or degenerate cells fall back to the locator
+    return locator->FindCell(x, 0.0, scratch.cell, pcoords,
+      scratch.weights.data());
+  }
+
+  bool interpolate(vtkDataArray* velocity, bool pointVelocity,
+    vtkIdType cellId, double x[3], double u[3], Scratch& scratch) {
+    u[0] = u[1] = u[2] = 0;
+
+    if (!pointVelocity) {
+      velocity->GetTuple(cellId, u);
+      return true;
+    }
+
+    double closest[3];
+    double pcoords[3];
+    double dist2;
+    int subId;
+
+    mesh->GetCell(cellId, scratch.cell);
+    if (scratch.cell->EvaluatePosition(
+      x, closest, subId, pcoords, dist2, scratch.weights.data()) < 0) {
+      return false;
+    }
+
+    vtkIdList* ptIds = scratch.cell->GetPointIds();
+    double tuple[3];
+
+    for (vtkIdType k = 0; k < ptIds->GetNumberOfIds(); ++k) {
+      velocity->GetTuple(ptIds->GetId(k), tuple);
+      u[0] += scratch.weights[k] * tuple[0];
+      u[1] += scratch.weights[k] * tuple[1];
+      u[2] += scratch.weights[k] * tuple[2];
+    }
+
+    return true;
+  }
+
+  void respawn(vtkIdType i, Scratch& scratch) {
+    double* x = &points[3*i];
+    double pcoords[3];
+    cells[i] = -1;
+    ages[i] = 0;
+    lifetimes[i] = lifetime * (0.5 + 0.5 * uniform(random[i]));
+
+    for (int attempt = 0; attempt < 8 && cells[i] < 0; ++attempt) {
+      double offset[3];
+      do {
+        for (int k = 0; k < 3; ++k) {
+          offset[k] = 2 * uniform(random[i]) - 1;
+        }
+      } while (offset[0]*offset[0] + offset[1]*offset[1] + offset[2]*offset[2] > 1);
+
+      for (int k = 0; k < 3; ++k) {
+        x[k] = center[k] + radius * offset[k];
+      }
+
+      cells[i] = locator->FindCell(x, 0.0, scratch.cell, pcoords,
+        scratch.weights.data());
+    }
+
+    // Particles that could not be placed wait at the center for the next step
+    if (cells[i] < 0) {
+      for (int k = 0; k < 3; ++k) {
+        x[k] = center[k];
+      }
+    }
+
+    for (int k = 0; k < 3; ++k) {
+      positions[3*i + k] = static_cast<float>(x[k]);
+    }
+  }
+
+  // xorshift32, one state per particle so steps are reproducible in parallel
+  static double uniform(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state / 4294967296.0;
+  }
+
+  static const int maxWalk = 64;
+
+  vtkSmartPointer<vtkUnstructuredGrid> mesh;
+  vtkSmartPointer<vtkStaticCellLocator> locator;
+  // Shared so that the class stays copyable
+  std::shared_ptr<vtkSMPThreadLocal<Scratch>> scratches =
+    std::make_shared<vtkSMPThreadLocal<Scratch>>();
+  int maxCellSize = 8;
+  double center[3] = {0, 0, 0};
+  double radius = 0;
+  double lifetime = 0;
+  vector<double> points;
+  vector<vtkIdType> cells;
+  vector<double> ages;
+  vector<double> lifetimes;
+  vector<uint32_t> random;
+};
+
+#endif // PARTICLES_H
@@ -0,0 +1,306 @@
+// Author: Carlos Peña-Monferrer (SIMZERO) - 2023
+
+#ifndef REORDER_H
+#define REORDER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <vtkCellData.h>
+#include <vtkIdList.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnstructuredGrid.h>
+
+using namespace std;
+
+// Cell and point orderings that keep neighbouring cells close in memory.
+// Orders are new-to-old maps: order[newId] = oldId.
+class Reorder {
+
+public:
+  // Cells sorted along a Morton (Z-order) curve of their centers
+  static vector<vtkIdType> morton(vtkUnstructuredGrid* grid) {
+    vtkIdType nCells = grid->GetNumberOfCells();
+    double bounds[6];
+    grid->GetBounds(bounds);
+
+    double scale[3];
+    for (int k = 0; k < 3; ++k) {
+      double extent = bounds[2*k + 1] - bounds[2*k];
+      scale[k] = extent > 0 ? 2097151.0 / extent : 0;
+    }
+
+    vector<pair<uint64_t, vtkIdType>> keys(nCells);
+    vtkNew<vtkIdList> ptIds;
+
+    for (vtkIdType cellId = 0; cellId < nCells; ++cellId) {
+      grid->GetCellPoints(cellId, ptIds);
+      double center[3] = {0, 0, 0};
+      vtkIdType npts = ptIds->GetNumberOfIds();
+
+      for (vtkIdType i = 0; i < npts; ++i) {
+        double p[3];
+        grid->GetPoint(ptIds->GetId(i), p);
+        center[0] += p[0];
+        center[1] += p[1];
+        center[2] += p[2];
+      }
+
+      uint64_t key = 0;
+      for (int k = 0; k < 3; ++k) {
+        double c = npts > 0 ? center[k] / npts : bounds[2*k];
+        uint64_t q = static_cast<uint64_t>((c - bounds[2*k]) * scale[k]);
+        key |= spreadBits(std::min<uint64_t>(q, 2097151)) << k;
+      }
+
+      keys[cellId] = {key, cellId};
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    vector<vtkIdType> order(nCells);
+    for (vtkIdType i = 0; i < nCells; ++i) {
+      order[i] = keys[i].second;
+    }
+
+    return order;
+  }
+
+  // Reverse Cuthill-McKee ordering of the graph of cells sharing a point
+  static vector<vtkIdType> rcm(vtkUnstructuredGrid* grid) {
+    vtkIdType nCells = grid->GetNumberOfCells();
+    vtkIdType nPoints = grid->GetNumberOfPoints();
+
+    // Cell to point and point to cell tables in CSR form
+    vector<vtkIdType> cellOffsets(nCells + 1, 0);
+    vector<vtkIdType> cellPoints;
+    vector<vtkIdType> pointOffsets(nPoints + 1, 0);
+    vtkNew<vtkIdList> ptIds;
+
+    cellPoints.reserve(nCells * 8);
+    for (vtkIdType cellId = 0; cellId < nCells; ++cellId) {
+      grid->GetCellPoints(cellId, ptIds);
+      for (vtkIdType i = 0; i < ptIds->GetNumberOfIds(); ++i) {
+        cellPoints.push_back(ptIds->GetId(i));
+        pointOffsets[ptIds->GetId(i) + 1]++;
+      }
+      cellOffsets[cellId + 1] = cellPoints.size();
+    }
+
+    for (vtkIdType pointId = 0; pointId < nPoints; ++pointId) {
+      pointOffsets[pointId + 1] += pointOffsets[pointId];
+    }
+
+    vector<vtkIdType> pointCells(pointOffsets[nPoints]);
+    vector<vtkIdType> fill(pointOffsets.begin(), pointOffsets.end() - 1);
+    for (vtkIdType cellId = 0; cellId < nCells; ++cellId) {
+      for (vtkIdType i = cellOffsets[cellId]; i < cellOffsets[cellId + 1]; ++i) {
+        pointCells[fill[cellPoints[i]]++] = cellId;
+      }
+    }
+
+    // The number of cell incidences over the cell points is used as the
+    // degree, avoiding an explicit adjacency table.
+    vector<vtkIdType> degree(nCells, 0);
+    for (vtkIdType cellId = 0; cellId < nCells; ++cellId) {
+      for (vtkIdType i = cellOffsets[cellId]; i < cellOffsets[cellId + 1]; ++i) {
+        degree[cellId] += pointOffsets[cellPoints[i] + 1] -
+          pointOffsets[cellPoints[i]];
+      }
+    }
+
+    vector<vtkIdType> order;
+    order.reserve(nCells);
+    vector<char> visited(nCells, 0);
+    vector<vtkIdType> mark(nCells, -1);
+    vtkIdType stamp = 0;
+    vector<vtkIdType> neighbors;
+
+    auto visitNeighbors = [&](vtkIdType cellId, vector<char>& seen,
+      vector<vtkIdType>& queue) {
+      neighbors.clear();
+      stamp++;
+      for (vtkIdType i = cellOffsets[cellId]; i < cellOffsets[cellId + 1]; ++i) {
+        vtkIdType pointId = cellPoints[i];
+        for (vtkIdType j = pointOffsets[pointId]; j < pointOffsets[pointId + 1]; ++j) {
+          vtkIdType neighbor = pointCells[j];
+          if (!seen[neighbor] && mark[neighbor] != stamp) {
+            mark[neighbor] = stamp;
+            neighbors.push_back(neighbor);
+          }
+        }
+      }
+
+      std::sort(neighbors.begin(), neighbors.end(),
+        [&](vtkIdType a, vtkIdType b) {
+          return degree[a] < degree[b];
+      });
+
+      for (vtkIdType neighbor : neighbors) {
+        seen[neighbor] = 1;
+        queue.push_back(neighbor);
+      }
+    };
+
+    vector<vtkIdType> cellsByDegree(nCells);
+    for (vtkIdType cellId = 0; cellId < nCells; ++cellId) {
+      cellsByDegree[cellId] = cellId;
+    }
+    std::stable_sort(cellsByDegree.begin(), cellsByDegree.end(),
+      [&](vtkIdType a, vtkIdType b) {
+        return degree[a] < degree[b];
+    });
+
+    vector<char> probeSeen(nCells, 0);
+    vector<vtkIdType> probe;
+
+    for (vtkIdType seed : cellsByDegree) {
+      if (visited[seed]) {
+        continue;
+      }
+
+      // One breadth-first sweep from the lowest degree cell of the component
+      // gives a pseudo-peripheral start cell.
+      probe.clear();
+      probe.push_back(seed);
+      probeSeen[seed] = 1;
+      for (size_t head = 0; head < probe.size(); ++head) {
+        visitNeighbors(probe[head], probeSeen, probe);
+      }
+      vtkIdType start = probe.back();
+
+      size_t head = order.size();
+      order.push_back(start);
+      visited[start] = 1;
+      for (; head < order.size(); ++head) {
+        visitNeighbors(order[head], visited, order);
+      }
+    }
+
+    std::reverse(order.begin(), order.end());
+
+    return order;
+  }
+
+  // Points numbered by first use in the given cell order. Points not used by
+  // any cell are kept at the end in their original order.
+  static vector<vtkIdType> points(vtkUnstructuredGrid* grid,
+    vector<vtkIdType> const& cellOrder) {
+    vtkIdType nPoints = grid->GetNumberOfPoints();
+    vector<vtkIdType> order;
+    order.reserve(nPoints);
+    vector<char> used(nPoints, 0);
+    vtkNew<vtkIdList> ptIds;
+
+    for (vtkIdType cellId : cellOrder) {
+      grid->GetCellPoints(cellId, ptIds);
+      for (vtkIdType i = 0; i < ptIds->GetNumberOfIds(); ++i) {
+        vtkIdType pointId = ptIds->GetId(i);
+        if (!used[pointId]) {
+          used[pointId] = 1;
+          order.push_back(pointId);
+        }
+      }
+    }
+
+    for (vtkIdType pointId = 0; pointId < nPoints; ++pointId) {
+      if (!used[pointId]) {
+        order.push_back(pointId);
+      }
+    }
+
+    return order;
+  }
+
+  static vector<vtkIdType> inverse(vector<vtkIdType> const& order) {
+    vector<vtkIdType> result(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      result[order[i]] = i;
+    }
+
+    return result;
+  }
+
+  // Builds a copy of the grid with its points, cells and attributes permuted
+  static vtkSmartPointer<vtkUnstructuredGrid> apply(vtkUnstructuredGrid* grid,
+    vector<vtkIdType> const& cellOrder, vector<vtkIdType> const& pointOrder) {
+    vtkIdType nCells = grid->GetNumberOfCells();
+    vtkIdType nPoints = grid->GetNumberOfPoints();
+    vector<vtkIdType> pointInverse = inverse(pointOrder);
+
+    vtkSmartPointer<vtkUnstructuredGrid> output =
+      vtkSmartPointer<vtkUnstructuredGrid>::New();
+
+    vtkNew<vtkPoints> points;
+    points->SetDataType(grid->GetPoints()->GetDataType());
+    points->SetNumberOfPoints(nPoints);
+    for (vtkIdType pointId = 0; pointId < nPoints; ++pointId) {
+      points->SetPoint(pointId, grid->GetPoint(pointOrder[pointId]));
+    }
+    output->SetPoints(points);
+
+    output->AllocateExact(nCells, grid->GetCells()->GetNumberOfConnectivityIds());
+    vtkNew<vtkIdList> ptIds;
+
+    for (vtkIdType cellId : cellOrder) {
+      int type = grid->GetCellType(cellId);
+
+      if (type == VTK_POLYHEDRON) {
+        // Face stream: (nFaces, nFace0Pts, id0, id1, ..., nFace1Pts, ...)
+        grid->GetFaceStream(cellId, ptIds);
+        vtkIdType* stream = ptIds->GetPointer(0);
+        vtkIdType nFaces = stream[0];
+        vtkIdType index = 1;
+
+        for (vtkIdType face = 0; face < nFaces; ++face) {
+          vtkIdType npts = stream[index++];
+          for (vtkIdType i = 0; i < npts; ++i, ++index) {
+            stream[index] = pointInverse[stream[index]];
+          }
+        }
+      }
+      else {
+        grid->GetCellPoints(cellId, ptIds);
+        for (vtkIdType i = 0; i < ptIds->GetNumberOfIds(); ++i) {
+          ptIds->SetId(i, pointInverse[ptIds->GetId(i)]);
+        }
+      }
+
+      output->InsertNextCell(type, ptIds);
+    }
+
+    output->GetPointData()->CopyAllocate(grid->GetPointData(), nPoints);
+    for (vtkIdType pointId = 0; pointId < nPoints; ++pointId) {
+      output->GetPointData()->CopyData(
+        grid->GetPointData(), pointOrder[pointId], pointId);
+    }
+
+    output->GetCellData()->CopyAllocate(grid->GetCellData(), nCells);
+    for (vtkIdType cellId = 0; cellId < nCells; ++cellId) {
+      output->GetCellData()->CopyData(
+        grid->GetCellData(), cellOrder[cellId], cellId);
+    }
+
+    output->GetFieldData()->ShallowCopy(grid->GetFieldData());
+
+    return output;
+  }
+
+private:
+  // Interleaves the lower 21 bits of v with two zero bits
+  static uint64_t spreadBits(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+  }
+};
+
+#endif // REORDER_H
@@ -0,0 +1,232 @@
+// Author: Carlos Peña-Monferrer (SIMZERO) - 2023
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <vtkNew.h>
+#include <vtkStaticCellLocator.h>
+#include <vtkUnstructuredGrid.h>
+
+#include "state.h"
+
+using namespace std;
+
+// Sparse interpolation operators between the grid cells and a regular image,
+// built once per mesh. Mesh buffers are stored by component in the original
+// cell order, and image buffers by channel with x varying fastest, i.e.
+// [c][z][y][x].
+class Resample {
+
+public:
+  // Cell centers as x,y,z triplets in grid cell order, and the original id
+  // of each grid cell, or null if not reordered
+  void build(vtkUnstructuredGrid* grid, const vtkIdType* order,
+    const double* centers, const double imageOrigin[3], const double imageSpacing[3],
+    const int imageDims[3]) {
+    nCells = grid->GetNumberOfCells();
+    nVoxels = static_cast<vtkIdType>(imageDims[0]) * imageDims[1] * imageDims[2];
+
+    for (int k = 0; k < 3; ++k) {
+      origin[k] = imageOrigin[k];
+      spacing[k] = imageSpacing[k];
+      dims[k] = imageDims[k];
+    }
+
+    // Mesh to image: each voxel takes the cell containing its center
+    vtkNew<vtkStaticCellLocator> locator;
+    locator->SetDataSet(grid);
+    locator->BuildLocator();
+
+    vector<vtkIdType> imageOffsets(1, 0);
+    vector<vtkIdType> imageColumns;
+    vector<float> imageWeights;
+    imageOffsets.reserve(nVoxels + 1);
+
+    for (int z = 0; z < dims[2]; ++z) {
+      for (int y = 0; y < dims[1]; ++y) {
+        for (int x = 0; x < dims[0]; ++x) {
+          double p[3] = {
+            origin[0] + x*spacing[0],
+            origin[1] + y*spacing[1],
+            origin[2] + z*spacing[2]
+          };
+
+          vtkIdType cellId = locator->FindCell(p);
+
+          if (cellId >= 0) {
+            imageColumns.push_back(order ? order[cellId] : cellId);
+            imageWeights.push_back(1.0f);
+          }
+
+          imageOffsets.push_back(imageColumns.size());
+        }
+      }
+    }
+
+    // Image to mesh: multilinear interpolation at the cell centers over the
+    // surrounding voxels that lie inside the mesh
+
+    vector<vtkIdType> rowOffsets(nCells + 1, 0);
+    vector<vtkIdType> rowColumns(nCells * 8);
+    vector<float> rowWeights(nCells * 8);
+    vector<char> rowCount(nCells, 0);
+
+    for (vtkIdType cellId = 0; cellId < nCells; ++cellId) {
+      vtkIdType row = order ? order[cellId] : cellId;
+      const double* p = &centers[3*cellId];
+
+      int lower[3];
+      double fraction[3];
+      for (int k = 0; k < 3; ++k) {
+        double index = spacing[k] != 0 ? (p[k] - origin[k]) / spacing[k] : 0;
+        index = std::min(std::max(index, 0.0), dims[k] - 1.0);
+        lower[k] = std::min(static_cast<int>(std::floor(index)),
+          std::max(dims[k] - 2, 0));
+        fraction[k] = dims[k] > 1 ? index - lower[k] : 0;
+      }
+
+      vtkIdType* columns = &rowColumns[row * 8];
+      float* weights = &rowWeights[row * 8];
+      int count = 0;
+      double total = 0;
+      vtkIdType nearest = -1;
+      double nearestWeight = -1;
+
+      for (int corner = 0; corner < 8; ++corner) {
+        int index[3];
+        double weight = 1;
+
+        for (int k = 0; k < 3; ++k) {
+          int offset = (corner >> k) & 1;
+          if (offset && dims[k] == 1) {
+            weight = 0;
+            break;
+          }
+          index[k] = lower[k] + offset;
+          weight *= offset ? fraction[k] : 1 - fraction[k];
+        }
+
+        if (weight <= 0) {
+          continue;
+        }
+
+        vtkIdType voxel = index[0] +
+          dims[0] * (index[1] + static_cast<vtkIdType>(dims[1]) * index[2]);
+
+        if (weight > nearestWeight) {
+          nearest = voxel;
+          nearestWeight = weight;
+        }
+
+        if (imageOffsets[voxel + 1] == imageOffsets[voxel]) {
+          continue;
+        }
+
+        columns[count] = voxel;
+        weights[count] = weight;
+        total += weight;
+        count++;
+      }
+
+      if (count == 0 && nearest >= 0) {
+        columns[0] = nearest;
+        weights[0] = 1;
+        total = 1;
+        count = 1;
+      }
+
+      for (int i = 0; i < count; ++i) {
+        weights[i] /= total;
+      }
+
+      rowCount[row] = count;
+    }
+
+    vector<vtkIdType> meshOffsets(nCells + 1, 0);
+    for (vtkIdType row = 0; row < nCells; ++row) {
+      meshOffsets[row + 1] = meshOffsets[row] + rowCount[row];
+    }
+
+    vector<vtkIdType> meshColumns(meshOffsets[nCells]);
+    vector<float> meshWeights(meshOffsets[nCells]);
+    for (vtkIdType row = 0; row < nCells; ++row) {
+      std::copy(&rowColumns[row * 8], &rowColumns[row * 8] + rowCount[row],
+        meshColumns.begin() + meshOffsets[row]);
+      std::copy(&rowWeights[row * 8], &rowWeights[row * 8] + rowCount[row],
+        meshWeights.begin() + meshOffsets[row]);
+    }
+
+    toImageOffsets = std::move(imageOffsets);
+    toImageColumns = std::move(imageColumns);
+    toImageWeights = std::move(imageWeights);
+    toMeshOffsets = std::move(meshOffsets);
+    toMeshColumns = std::move(meshColumns);
+    toMeshWeights = std::move(meshWeights);
+  }
+
+  bool built() const {
+    return nVoxels > 0;
+  }
+
+  void clear() {
+    nCells = 0;
+    nVoxels = 0;
+    toImageOffsets.clear();
+    toImageColumns.clear();
+    toImageWeights.clear();
+    toMeshOffsets.clear();
+    toMeshColumns.clear();
+    toMeshWeights.clear();
+  }
+
+  // Voxels outside the mesh are set to zero
+  template <typename ValueType>
+  void toImage(const ValueType* mesh, ValueType* image, int channels) const {
+    for (int c = 0; c < channels; ++c) {
+      gather(toImageOffsets.data(), toImageColumns.data(),
+        toImageWeights.data(), mesh + c*nCells, image + c*nVoxels, nVoxels);
+    }
+  }
+
+  template <typename ValueType>
+  void toMesh(const ValueType* image, ValueType* mesh, int channels) const {
+    for (int c = 0; c < channels; ++c) {
+      gather(toMeshOffsets.data(), toMeshColumns.data(), toMeshWeights.data(),
+        image + c*nVoxels, mesh + c*nCells, nCells);
+    }
+  }
+
+  vtkIdType nCells = 0;
+  vtkIdType nVoxels = 0;
+  double origin[3] = {0, 0, 0};
+  double spacing[3] = {1, 1, 1};
+  int dims[3] = {0, 0, 0};
+  // CSR operators, rows are image voxels and mesh cells respectively. They
+  // point into the state blob when restored.
+  StateArray<vtkIdType> toImageOffsets;
+  StateArray<vtkIdType> toImageColumns;
+  StateArray<float> toImageWeights;
+  StateArray<vtkIdType> toMeshOffsets;
+  StateArray<vtkIdType> toMeshColumns;
+  StateArray<float> toMeshWeights;
+
+private:
+  template <typename ValueType>
+  static void gather(const vtkIdType* offsets, const vtkIdType* columns,
+    const float* weights,
+    const ValueType* source, ValueType* target, vtkIdType nRows) {
+    for (vtkIdType row = 0; row < nRows; ++row) {
+      ValueType value = 0;
+      for (vtkIdType i = offsets[row]; i < offsets[row + 1]; ++i) {
+        value += weights[i] * source[columns[i]];
+      }
+      target[row] = value;
+    }
+  }
+};
+
+#endif // RESAMPLE_H
@@ -0,0 +1,411 @@
+// Author: Carlos Peña-Monferrer (SIMZERO) - 2023
+
+#ifndef STATE_H
+#define STATE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdTypeArray.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+using namespace std;
+
+// Binary blob of prepared mesh state. Layout, little endian:
+//   header: magic[8], version (uint32), sizeof(vtkIdType) (uint32),
+//           payload size (uint64), payload checksum (uint64)
+//   payload: sections of tag[4], VTK data type (int32), components (int32),
+//            name size (int32), tuples (int64), data size (int64), followed
+//            by the name and the data, each padded to 8 bytes.
+// Unknown sections are skipped when reading.
+class State {
+
+public:
+  static const uint32_t version = 2;
+  static const size_t headerSize = 32;
+  static const size_t sectionSize = 32;
+
+  static uint64_t checksum(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    size_t words = size / 8;
+
+    for (size_t i = 0; i < words; ++i) {
+      uint64_t word;
+      std::memcpy(&word, data + 8*i, 8);
+      hash ^= word;
+      hash *= 1099511628211ULL;
+    }
+
+    for (size_t i = 8*words; i < size; ++i) {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 1099511628211ULL;
+    }
+
+    return hash;
+  }
+
+  static const char* magic() {
+    return "JSFLUIDS";
+  }
+};
+
+// Values either owned or pointing into a restored state blob, which must
+// outlive them
+template <typename ValueType>
+class StateArray {
+
+public:
+  StateArray& operator=(vector<ValueType> values) {
+    owned.swap(values);
+    view = nullptr;
+    viewSize = 0;
+    return *this;
+  }
+
+  void point(const ValueType* data, size_t size) {
+    vector<ValueType>().swap(owned);
+    view = data;
+    viewSize = size;
+  }
+
+  void clear() {
+    *this = vector<ValueType>();
+  }
+
+  const ValueType* data() const {
+    return view ? view : owned.data();
+  }
+
+  size_t size() const {
+    return view ? viewSize : owned.size();
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  ValueType const& operator[](size_t i) const {
+    return data()[i];
+  }
+
+private:
+  vector<ValueType> owned;
+  const ValueType* view = nullptr;
+  size_t viewSize = 0;
+};
+
+class StateWriter {
+
+public:
+  void add(const char tag[4], string const& name, int dataType,
+    int components, int64_t tuples, const void* data, int64_t dataSize) {
+    size_t offset = payload.size();
+    payload.resize(offset + State::sectionSize);
+    char* section = &payload[offset];
+
+    int32_t nameSize = name.size();
+    std::memcpy(section, tag, 4);
+    std::memcpy(section + 4, &dataType, 4);
+    std::memcpy(section + 8, &components, 4);
+    std::memcpy(section + 12, &nameSize, 4);
+    std::memcpy(section + 16, &tuples, 8);
+    std::memcpy(section + 24, &dataSize, 8);
+
+    append(name.data(), name.size());
+    append(data, dataSize);
+  }
+
+  void add(const char tag[4], string const& name, vtkDataArray* array) {
+    if (!array) {
+      return;
+    }
+
+    add(tag, name, array->GetDataType(), array->GetNumberOfComponents(),
+      array->GetNumberOfTuples(), array->GetVoidPointer(0),
+      static_cast<int64_t>(array->GetNumberOfValues()) *
+        array->GetDataTypeSize());
+  }
+
+  // Cell array offsets and connectivity, always stored as vtkIdType
+  void add(const char offsetsTag[4], const char connectivityTag[4],
+    vtkCellArray* cells) {
+    if (!cells) {
+      return;
+    }
+
+    vtkNew<vtkIdTypeArray> offsets;
+    offsets->DeepCopy(cells->GetOffsetsArray());
+    vtkNew<vtkIdTypeArray> connectivity;
+    connectivity->DeepCopy(cells->GetConnectivityArray());
+
+    add(offsetsTag, "", offsets);
+    add(connectivityTag, "", connectivity);
+  }
+
+  // All the numerical arrays, by name
+  void add(const char tag[4], vtkFieldData* fields) {
+    for (int i = 0; i < fields->GetNumberOfArrays(); ++i) {
+      vtkDataArray* array = fields->GetArray(i);
+
+      if (array && array->GetName()) {
+        add(tag, array->GetName(), array);
+      }
+    }
+  }
+
+  template <typename ValueType>
+  void add(const char tag[4], vector<ValueType> const& values, int dataType) {
+    add(tag, "", dataType, 1, values.size(), values.data(),
+      values.size() * sizeof(ValueType));
+  }
+
+  template <typename ValueType>
+  void add(const char tag[4], StateArray<ValueType> const& values,
+    int dataType) {
+    add(tag, "", dataType, 1, values.size(), values.data(),
+      values.size() * sizeof(ValueType));
+  }
+
+  string finish() const {
+    string blob(State::headerSize, '\0');
+    uint32_t version = State::version;
+    uint32_t idTypeSize = sizeof(vtkIdType);
+    uint64_t payloadSize = payload.size();
+    uint64_t checksum = State::checksum(payload.data(), payload.size());
+
+    std::memcpy(&blob[0], State::magic(), 8);
+    std::memcpy(&blob[8], &version, 4);
+    std::memcpy(&blob[12], &idTypeSize, 4);
+    std::memcpy(&blob[16], &payloadSize, 8);
+    std::memcpy(&blob[24], &checksum, 8);
+    blob.append(payload);
+
+    return blob;
+  }
+
+private:
+  void append(const void* data, size_t size) {
+    size_t padded = (size + 7) & ~static_cast<size_t>(7);
+    size_t offset = payload.size();
+    payload.resize(offset + padded, '\0');
+
+    if (size > 0) {
+      std::memcpy(&payload[offset], data, size);
+    }
+  }
+
+  string payload;
+};
+
+// Arrays read from a blob point into it, so the blob must outlive them
+class StateReader {
+
+public:
+  struct Section {
+    string tag;
+    string name;
+    int dataType;
+    int components;
+    int64_t tuples;
+    int64_t dataSize;
+    char* data;
+  };
+
+  bool parse(string& blob) {
+    sections.clear();
+
+    if (blob.size() < State::headerSize ||
+      std::memcmp(blob.data(), State::magic(), 8) != 0) {
+      return false;
+    }
+
+    uint32_t version;
+    uint32_t idTypeSize;
+    uint64_t payloadSize;
+    uint64_t checksum;
+    std::memcpy(&version, &blob[8], 4);
+    std::memcpy(&idTypeSize, &blob[12], 4);
+    std::memcpy(&payloadSize, &blob[16], 8);
+    std::memcpy(&checksum, &blob[24], 8);
+
+    if (version != State::version || idTypeSize != sizeof(vtkIdType) ||
+      payloadSize != blob.size() - State::headerSize) {
+      return false;
+    }
+
+    char* payload = &blob[State::headerSize];
+
+    if (State::checksum(payload, payloadSize) != checksum) {
+      return false;
+    }
+
+    // Sizes are checked in 64 bits against what is left of the payload, so
+    // that they cannot wrap around before narrowing them on wasm32
+    uint64_t offset = 0;
+
+    while (payloadSize - offset >= State::sectionSize) {
+      Section section;
+      char* header = payload + offset;
+      int32_t nameSize;
+
+      section.tag.assign(header, 4);
+      std::memcpy(&section.dataType, header + 4, 4);
+      std::memcpy(&section.components, header + 8, 4);
+      std::memcpy(&nameSize, header + 12, 4);
+      std::memcpy(&section.tuples, header + 16, 8);
+      std::memcpy(&section.dataSize, header + 24, 8);
+      offset += State::sectionSize;
+
+      if (nameSize < 0 || section.dataSize < 0) {
+        return false;
+      }
+
+      uint64_t remaining = payloadSize - offset;
+      uint64_t paddedName = (static_cast<uint64_t>(nameSize) + 7) & ~static_cast<uint64_t>(7);
+
+      if (paddedName > remaining) {
+        return false;
+      }
+
+      remaining -= paddedName;
+      uint64_t dataSize = static_cast<uint64_t>(section.dataSize);
+
+      if (dataSize > remaining) {
+        return false;
+      }
+
+      uint64_t paddedData = (dataSize + 7) & ~static_cast<uint64_t>(7);
+
+      if (paddedData > remaining) {
+        return false;
+      }
+
+      section.name.assign(payload + offset, nameSize);
+      offset += paddedName;
+      section.data = payload + offset;
+      offset += paddedData;
+
+      sections.push_back(section);
+    }
+
+    return true;
+  }
+
+  const Section* find(const char tag[4], string const& name = "") const {
+    for (auto const& section : sections) {
+      if (section.tag.compare(0, 4, tag, 4) == 0 && section.name == name) {
+        return &section;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // A VTK array over the section data, without copying it
+  static vtkSmartPointer<vtkDataArray> array(Section const& section) {
+    vtkSmartPointer<vtkDataArray> array =
+      vtkSmartPointer<vtkDataArray>::Take(
+        vtkDataArray::CreateDataArray(section.dataType));
+
+    if (!array || section.components < 1 || section.tuples < 0 ||
+      array->GetDataTypeSize() < 1) {
+      return nullptr;
+    }
+
+    // Divided rather than multiplied to reject sizes that would overflow
+    int64_t valueSize =
+      static_cast<int64_t>(section.components) * array->GetDataTypeSize();
+
+    if (section.dataSize % valueSize != 0 ||
+      section.tuples != section.dataSize / valueSize) {
+      return nullptr;
+    }
+
+    array->SetNumberOfComponents(section.components);
+    array->SetVoidArray(section.data, section.tuples * section.components, 1);
+
+    if (!section.name.empty()) {
+      array->SetName(section.name.c_str());
+    }
+
+    return array;
+  }
+
+  vtkSmartPointer<vtkDataArray> array(const char tag[4],
+    string const& name = "") const {
+    const Section* section = find(tag, name);
+    return section ? array(*section) : nullptr;
+  }
+
+  vtkSmartPointer<vtkCellArray> cells(const char offsetsTag[4],
+    const char connectivityTag[4]) const {
+    vtkSmartPointer<vtkDataArray> offsets = array(offsetsTag);
+    vtkSmartPointer<vtkDataArray> connectivity = array(connectivityTag);
+
+    if (!vtkIdTypeArray::SafeDownCast(offsets) ||
+      !vtkIdTypeArray::SafeDownCast(connectivity)) {
+      return nullptr;
+    }
+
+    vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+    cells->SetData(vtkIdTypeArray::SafeDownCast(offsets),
+      vtkIdTypeArray::SafeDownCast(connectivity));
+
+    return cells;
+  }
+
+  // Adds all the arrays with the given tag
+  void fields(const char tag[4], vtkFieldData* fields) const {
+    for (auto const& section : sections) {
+      if (section.tag.compare(0, 4, tag, 4) == 0) {
+        vtkSmartPointer<vtkDataArray> fieldArray = array(section);
+        if (fieldArray) {
+          fields->AddArray(fieldArray);
+        }
+      }
+    }
+  }
+
+  // Copies the section into values, which are left empty if it is missing
+  template <typename ValueType>
+  bool read(const char tag[4], vector<ValueType>& values,
+    string const& name = "") const {
+    const Section* section = find(tag, name);
+    values.clear();
+
+    if (!section || section->dataSize % sizeof(ValueType) != 0) {
+      return false;
+    }
+
+    const ValueType* data = reinterpret_cast<const ValueType*>(section->data);
+    values.assign(data, data + section->dataSize / sizeof(ValueType));
+
+    return true;
+  }
+
+  // Points values at the section data, and empties them if it is missing
+  template <typename ValueType>
+  bool view(const char tag[4], StateArray<ValueType>& values) const {
+    const Section* section = find(tag);
+    values.clear();
+
+    if (!section || section->dataSize % sizeof(ValueType) != 0) {
+      return false;
+    }
+
+    values.point(reinterpret_cast<const ValueType*>(section->data),
+      section->dataSize / sizeof(ValueType));
+
+    return true;
+  }
+
+  vector<Section> sections;
+};
+
+#endif // STATE_H
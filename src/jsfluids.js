@@ -60,6 +60,71 @@ class VTKFunctions {
     return instance.exportUnstructuredGrid();
   }
 
+  exportData(instance, dict) {
+    switch (dict.target) {
+      case 'grid':
+      case 'surface':
+      case 'component':
+        return instance.exportData(dict.target, dict.delta === true);
+      break;
+      default:
+        throw new Error('Invalid export target. Only grid, surface and '
+          + 'component are currently supported.');
+      break;
+    }
+  }
+
+  setExportOptions(instance, dict) {
+    const mode = 'mode' in dict ? dict.mode : 'appended';
+    const compressor = 'compressor' in dict ? dict.compressor : 'zlib';
+    const level = 'level' in dict ? dict.level : 5;
+
+    if (!['ascii', 'binary', 'appended'].includes(mode)) {
+      throw new Error('Invalid export mode. Only ascii, binary and appended '
+        + 'are currently supported.');
+    }
+
+    if (!['none', 'zlib', 'lz4', 'lzma'].includes(compressor)) {
+      throw new Error('Invalid compressor. Only none, zlib, lz4 and lzma '
+        + 'are currently supported.');
+    }
+
+    if (!Number.isInteger(level) || level < 1 || level > 9) {
+      throw new Error('Invalid compression level. Must be an integer from 1'
+        + ' to 9.');
+    }
+
+    instance.setExportOptions(mode, compressor, level);
+  }
+
+  exportState(instance) {
+    return instance.exportState();
+  }
+
+  restoreState(instance, state) {
+    let buffer;
+
+    if (state instanceof ArrayBuffer) {
+      buffer = new Uint8Array(state);
+    } else if (ArrayBuffer.isView(state)) {
+      buffer = new Uint8Array(state.buffer, state.byteOffset, state.byteLength);
+    } else {
+      throw new Error('Invalid state type. Must be either a TypedArray or'
+        + ' an ArrayBuffer.');
+    }
+
+    // Copied once into wasm memory and read in place from there
+    instance.stateBuffer(buffer.length).set(buffer);
+    const nCells = instance.restoreState();
+
+    if (nCells === 0) {
+      throw new Error('Invalid state. It is either corrupted, or written by'
+        + ' another version, model or load options.');
+    }
+
+    return nCells;
+  }
+
   setComponent(dict, instance) {
     switch (dict.component) {
       case 'surface':
@@ -140,6 +205,38 @@ class VTKFunctions {
     return instance.probe(dict.field, dict.point[0], dict.point[1], dict.point[2]);
   }
 
+  setParticles(instance, dict) {
+    if (!Number.isInteger(dict.count) || dict.count < 0) {
+      throw new Error('Invalid particle count. Must be a non-negative'
+        + ' integer.');
+    }
+
+    if (!(dict.radius > 0) || !(dict.lifetime > 0)) {
+      throw new Error('Invalid particle radius or lifetime. Both must be'
+        + ' positive.');
+    }
+
+    instance.seedParticles(
+      dict.count,
+      dict.center[0],
+      dict.center[1],
+      dict.center[2],
+      dict.radius,
+      dict.lifetime
+    );
+  }
+
+  advect(instance, dict) {
+    const positions = instance.advectParticles(dict.dt, dict.field);
+
+    if (positions === null) {
+      throw new Error('Invalid velocity field. It must be a point or cell'
+        + ' field with 3 components.');
+    }
+
+    return positions;
+  }
+
   render(component, dict, instance) {
     instance.removeAllActors();
 
@@ -194,6 +291,7 @@ class MLWrapper extends VTKFunctions {
     this.fieldName = "U";
     this.nComponents = "1";
     this.nCells = "0";
+    this.nVoxels = 0;
     this.operations = [];
   }
 
@@ -220,9 +318,23 @@ class MLWrapper extends VTKFunctions {
    * - If mesh is a TypedArray, the mesh will be decoded from UTF-8 to a string.
    * - If mesh is a string, it is treated as an URL and the mesh will be loaded
    *   from the URL.
+   * @param {Object} [options] - The load options.
+   * @property {string} [options.precision] - The field storage, "float64"
+   * (default) or "float32". With "float32" the grid arrays, field buffers,
+   * derived fields and SDFAndRegion output are single precision, so
+   * Float32Array data such as ONNX Runtime outputs is used without
+   * conversion.
+   * @property {string} [options.reorder] - Reorders the grid cells and points
+   * for memory locality, speeding up interpolation, gradients, probes and
+   * cutting on large grids. Must be one of "none" (default), "morton" for a
+   * space-filling curve or "rcm" for reverse Cuthill-McKee. Field data and
+   * SDFAndRegion keep the original cell order expected by the models.
    */
-  async loadMesh(mesh) {
+  async loadMesh(mesh, options = {}) {
     await this.init();
+    this.setLoadOptions(options);
+    this.nVoxels = 0;
+
     if (Buffer.isBuffer(mesh)) {
       this.nCells = this.ml.readUnstructuredGrid(mesh);
     } else if (ArrayBuffer.isView(mesh)) {
@@ -239,6 +351,63 @@ class MLWrapper extends VTKFunctions {
     this.ml.initScene();
   }
 
+  /**
+   * Exports the prepared mesh state: the grid with its fields, the
+   * reordering, the cell centers, the boundary surface and the image grid
+   * operators. The state is a versioned and checksummed binary blob that
+   * can be stored, e.g. in IndexedDB or on disk, and loaded with loadState
+   * in a later session instead of loading and preparing the mesh again.
+   *
+   * @example
+   * var state = model.exportState();
+   * @returns {Uint8Array} The state.
+   */
+  exportState() {
+    return super.exportState(this.ml);
+  }
+
+  /**
+   * Loads a state written by exportState, replacing loadMesh and
+   * setImageGrid. The grid arrays are used in place from the state.
+   * Locators are not part of the state and are built again on first use.
+   *
+   * @example
+   * model.loadState(state, { precision: 'float32' }).then(() => {
+   *   ...
+   * });
+   * @param {TypedArray|ArrayBuffer} state - The state.
+   * @param {Object} [options] - The precision and reorder options used
+   * in loadMesh when the state was exported, see loadMesh.
+   * @throws {Error} If the state is corrupted, written by another version
+   * or another model, or with other options, in which case the mesh must be
+   * loaded with loadMesh.
+   */
+  async loadState(state, options = {}) {
+    await this.init();
+    this.setLoadOptions(options);
+    this.nCells = super.restoreState(this.ml, state);
+    this.nVoxels = this.ml.imageVoxels();
+    this.ml.initScene();
+  }
+
+  setLoadOptions(options) {
+    const precision = 'precision' in options ? options.precision : 'float64';
+    const reorder = 'reorder' in options ? options.reorder : 'none';
+
+    if (precision !== 'float64' && precision !== 'float32') {
+      throw new Error('Invalid precision. Only float64 and float32 are'
+        + ' currently supported.');
+    }
+
+    if (!['none', 'morton', 'rcm'].includes(reorder)) {
+      throw new Error('Invalid reorder method. Only none, morton and rcm are'
+        + ' currently supported.');
+    }
+
+    this.ml.setPrecision(precision);
+    this.ml.setReordering(reorder);
+  }
+
   /**
    * Computes the signed distance field (SDF) and flow region fields on the
    * grid based on an STL.
@@ -254,7 +423,8 @@ class MLWrapper extends VTKFunctions {
    * @example
    * var sdf = model.SDFAndRegion(stlBuffer);
    * @param {Buffer} buffer - The STL buffer
-   * @returns {Float64Array} The array with fields SDF1, flowRegion and SDF2.
+   * @returns {Float64Array|Float32Array} The array with fields SDF1, flowRegion
+   * and SDF2, in the precision selected in loadMesh.
    */
   SDFAndRegion(geometry) {
     var vtk = this.ml.stlToVtp(geometry);
@@ -262,6 +432,205 @@ class MLWrapper extends VTKFunctions {
     return this.ml.computeSDFAndRegion(vtk);
   }
 
+  /**
+   * Sets a regular image grid for models working on 2D/3D tensors, such as
+   * DeepCFD, and builds the sparse operators between the grid cells and the
+   * image once. Each frame then only resamples through these operators.
+   * - Image data is laid out by channel with x varying fastest, i.e.
+   *   [channel][z][y][x]. For 2D images set dims[2] to 1.
+   * - Voxels are sampled at origin + index * spacing and take the value of
+   *   the cell containing them, or zero outside the grid.
+   * - Cells are interpolated from the surrounding voxels inside the grid.
+   *
+   * @example
+   * model.setImageGrid({
+   *   origin: [0, 0, 0],
+   *   spacing: [0.01, 0.01, 1],
+   *   dims: [172, 79, 1]
+   * });
+   * @param {Object} dict - The input dictionary.
+   * @property {number[]} dict.origin - The x,y,z coordinates of the first voxel
+   * @property {number[]} dict.spacing - The x,y,z voxel spacing
+   * @property {number[]} dict.dims - The number of voxels in x,y,z
+   * @returns {void}
+   * @throws {Error} If a dimension is lower than 1, in which case the
+   * previous image grid is kept.
+   */
+  setImageGrid(dict) {
+    const nVoxels = this.ml.setImageGrid(
+      dict.origin[0],
+      dict.origin[1],
+      dict.origin[2],
+      dict.spacing[0],
+      dict.spacing[1],
+      dict.spacing[2],
+      dict.dims[0],
+      dict.dims[1],
+      dict.dims[2]
+    );
+
+    if (nVoxels === 0) {
+      throw new Error('Invalid image dimensions.');
+    }
+
+    this.nVoxels = nVoxels;
+  }
+
+  /**
+   * Removes the image grid set with setImageGrid, so that predictions take
+   * mesh inputs again.
+   *
+   * @example
+   * model.clearImageGrid();
+   * @returns {void}
+   */
+  clearImageGrid() {
+    this.ml.clearImageGrid();
+    this.nVoxels = 0;
+  }
+
+  /**
+   * Computes the SDF and flow region fields like SDFAndRegion and resamples
+   * them on the image set with setImageGrid.
+   *
+   * @example
+   * var input = model.SDFAndRegionImage(stlBuffer);
+   * var tensor = new ort.Tensor("float32", input, [1, 3, 79, 172]);
+   * @param {Buffer} geometry - The STL buffer
+   * @returns {Float64Array|Float32Array} The image with channels SDF1,
+   * flowRegion and SDF2, in the precision selected in loadMesh.
+   * @throws {Error} If no image grid is set for the loaded mesh.
+   */
+  SDFAndRegionImage(geometry) {
+    this.ml.updateSDFAndRegion(this.ml.stlToVtp(geometry));
+    const image = this.ml.imageSDFAndRegion();
+
+    if (image === null) {
+      throw new Error('No image grid set for the loaded mesh. Call'
+        + ' setImageGrid first.');
+    }
+
+    return image;
+  }
+
+  /**
+   * Resamples an image field on the grid cells, updates the grid and applies
+   * the operations defined in setOperations.
+   * - It takes data with size the number of voxels for scalars or three times
+   *   the size for vectors.
+   *
+   * @example
+   * model.updateFromImage({ field: "U", data: results.output.data });
+   * @param {Object} dict - The input dictionary.
+   * @property {string} dict.field - The field
+   * @property {Float64Array|Float32Array} dict.data - The image field
+   * @throws {Error} If no image grid is set for the loaded mesh.
+   * @returns {void}
+   */
+  updateFromImage(dict) {
+    // Read on every call, as loading another mesh invalidates the image grid
+    this.nVoxels = this.ml.imageVoxels();
+
+    if (this.nVoxels === 0) {
+      throw new Error('No image grid set for the loaded mesh. Call'
+        + ' setImageGrid first.');
+    }
+
+    if (dict.data.length === 3 * this.nVoxels) {
+      this.nComponents = 3;
+    } else if (dict.data.length === this.nVoxels) {
+      this.nComponents = 1;
+    } else {
+      throw new Error('Invalid image data, not identified as scalar or vector.');
+    }
+
+    this.fieldName = dict.field;
+    this.ml.imageField(this.nComponents).set(dict.data);
+
+    if (!this.ml.imageToMesh(this.fieldName, this.nComponents)) {
+      throw new Error('No image grid set for the loaded mesh. Call'
+        + ' setImageGrid first.');
+    }
+
+    super.operations(this.ml, this.operations);
+  }
+
+  /**
+   * Loads an ONNX model for the in-process inference backend, from either an
+   * URL or a buffer. The model must take float32 SDF1, flowRegion and SDF2
+   * fields and return a scalar or vector field, on the grid cells or on the
+   * image set with setImageGrid. While an image grid is set, the model runs
+   * on the image; call clearImageGrid to run it on the grid cells again.
+   * Dynamic dimensions are supported: the batch dimension runs with size
+   * one, and the others take the number of cells or the image dimensions.
+   *
+   * Note: This function requires a build with WITH_ONNXRUNTIME=true.
+   * @example
+   * model.loadModel(onnxURL).then(() => {
+   *   model.predict({ field: "U", geometry: stlBuffer });
+   * });
+   * @param {Buffer|TypedArray|string} onnxModel - The ONNX model, which can
+   * be either an URL or a buffer.
+   */
+  async loadModel(onnxModel) {
+    if (typeof this.ml.loadModel !== 'function') {
+      throw new Error('In-process inference not available. Build with'
+        + ' WITH_ONNXRUNTIME=true.');
+    }
+
+    let data;
+    if (Buffer.isBuffer(onnxModel) || ArrayBuffer.isView(onnxModel)) {
+      data = onnxModel;
+    } else if (typeof onnxModel === 'string') {
+      const response = await axios.get(onnxModel, {responseType: 'arraybuffer'});
+      data = new Uint8Array(response.data);
+    } else {
+      throw new Error('Invalid input type. Must be either a'
+        + ' Buffer or a URL string.');
+    }
+
+    if (!this.ml.loadModel(data)) {
+      throw new Error('Invalid ONNX model.');
+    }
+  }
+
+  /**
+   * Runs a whole frame with the model loaded in loadModel: optionally computes
+   * the SDF and flow region from a new geometry, runs the inference on them,
+   * writes the result into the grid field and applies the operations defined
+   * in setOperations. No field data is copied through JavaScript.
+   *
+   * Note: This function requires a build with WITH_ONNXRUNTIME=true.
+   * @example
+   * model.predict({ field: "U", geometry: stlBuffer });
+   * @param {Object} dict - The input dictionary.
+   * @property {string} dict.field - The predicted field
+   * @property {Buffer} [dict.geometry] - The STL buffer. If not given, the
+   * last computed SDF and flow region are used.
+   * @returns {void}
+   */
+  predict(dict) {
+    if (typeof this.ml.predictAndUpdate !== 'function') {
+      throw new Error('In-process inference not available. Build with'
+        + ' WITH_ONNXRUNTIME=true.');
+    }
+
+    if ('geometry' in dict) {
+      this.ml.updateSDFAndRegion(this.ml.stlToVtp(dict.geometry));
+    }
+
+    this.fieldName = dict.field;
+    const components = this.ml.predictAndUpdate(this.fieldName);
+
+    if (components === 0) {
+      throw new Error('Inference failed. The model input and output sizes'
+        + ' must match the grid and a geometry must have been set.');
+    }
+
+    this.nComponents = components;
+    super.operations(this.ml, this.operations);
+  }
+
   /**
    * Updates the fields in the loaded grid and applies the operations defined
    * in setOperations.
@@ -270,7 +639,9 @@ class MLWrapper extends VTKFunctions {
    * model.update({ name: "U", data: U });
    * @param {Object} dict - The input dictionary.
    * @property {string} dict.field - The field
-   * @property {Float64Array} dict.data - The data field
+   * @property {Float64Array|Float32Array} dict.data - The data field. It is
+   * copied without conversion when it matches the precision selected in
+   * loadMesh.
    * @returns {void}
    */
   update(dict) {
@@ -300,6 +671,53 @@ class MLWrapper extends VTKFunctions {
     return super.grid(this.ml);
   }
 
+  /**
+   * Gets a compressed VTK XML file (.vtu for the grid, .vtp otherwise) as a
+   * byte array, written with the options set in setExportOptions.
+   *
+   * With delta enabled, and if the topology has not changed since the last
+   * delta export of the same target, the result is an empty .vtp holding
+   * only the arrays that changed as field data, named "PointData:<name>" or
+   * "CellData:<name>". A "RemovedArrays" string array lists the arrays
+   * that are no longer present. Otherwise the full file is returned, so the
+   * first delta export is the base file. Exports without delta reset it.
+   *
+   * @example
+   * model.setExportOptions({ mode: "appended", compressor: "lz4" });
+   * var base = model.exportData({ target: "grid", delta: true });
+   * model.update({ field: "U", data: U });
+   * var delta = model.exportData({ target: "grid", delta: true });
+   * @param {Object} dict - The input dictionary.
+   * @property {string} dict.target - The data to export. Must be one of:
+   * - "grid" for the whole grid,
+   * - "surface" for the grid boundary, or
+   * - "component" for the active component.
+   * @property {boolean} [dict.delta] - Exports only the changed arrays.
+   * @returns {Uint8Array} The file data
+   */
+  exportData(dict) {
+    return super.exportData(this.ml, dict);
+  }
+
+  /**
+   * Sets the writer options used by exportData.
+   *
+   * @example
+   * model.setExportOptions({ mode: "appended", compressor: "zlib", level: 9 });
+   * @param {Object} dict - The input dictionary.
+   * @property {string} [dict.mode] - The data mode, "ascii", "binary" (base64
+   * inline) or "appended" (raw binary, default).
+   * @property {string} [dict.compressor] - The compressor, "none", "zlib"
+   * (default), "lz4" or "lzma".
+   * @property {number} [dict.level] - The compression level from 1 (fastest)
+   * to 9 (smallest). Defaults to 5.
+   * @returns {void}
+   * @throws {Error} If an option is not one of the supported values.
+   */
+  setExportOptions(dict) {
+    super.setExportOptions(this.ml, dict);
+  }
+
   /**
    * Gets the value of a given field at a given point.
    *
@@ -316,6 +734,54 @@ class MLWrapper extends VTKFunctions {
     return super.probe(this.ml, dict);
   }
 
+  /**
+   * Seeds tracer particles for advect, uniformly in a sphere. Particles are
+   * respawned in the sphere when they leave the grid or their lifetime
+   * expires. Lifetimes are randomized between half and the full lifetime.
+   *
+   * @example
+   * model.setParticles({
+   *   count: 10000,
+   *   center: [0, 0, 0],
+   *   radius: 1.0,
+   *   lifetime: 5.0
+   * });
+   * @param {Object} dict - The input dictionary.
+   * @property {number} dict.count - The number of particles
+   * @property {number[]} dict.center - The center of the seeding sphere, an
+   * array with three numbers representing the x,y,z coordinates.
+   * @property {number} dict.radius - The radius of the seeding sphere
+   * @property {number} dict.lifetime - The maximum particle lifetime
+   * @returns {void}
+   * @throws {Error} If count is not a non-negative integer, or radius or
+   * lifetime is not positive.
+   */
+  setParticles(dict) {
+    super.setParticles(this.ml, dict);
+  }
+
+  /**
+   * Advances the particles seeded with setParticles one time step through
+   * the current velocity field and returns their positions, e.g. for
+   * instanced rendering.
+   * - Particles track the cell containing them and move by walking through
+   *   neighbor cells, without a global search per step.
+   * - The returned array is a view of a buffer reused across steps. It is
+   *   only valid until the next call to the module.
+   *
+   * @example
+   * var positions = model.advect({ field: "U", dt: 0.01 });
+   * @param {Object} dict - The input dictionary.
+   * @property {string} dict.field - The velocity field
+   * @property {number} dict.dt - The time step
+   * @returns {Float32Array} The particle positions as x,y,z triplets
+   * @throws {Error} If the field is not a point or cell field with 3
+   * components.
+   */
+  advect(dict) {
+    return super.advect(this.ml, dict);
+  }
+
   /**
    * Gets the integrated value of a given field for the whole domain or the
    * active component.
@@ -477,6 +943,10 @@ class ITHACAFVWrapper extends VTKFunctions {
 
     this.component = "surface";
     this.operations = [];
+    this.cache = new Map();
+    this.cacheSize = 8;
+    this.cacheSlot = 0;
+    this.resetCacheStats();
   }
 
   async init(){
@@ -513,6 +983,7 @@ class ITHACAFVWrapper extends VTKFunctions {
    */
   async loadMesh(mesh) {
     await this.init();
+    this.cache.clear();
     if (Buffer.isBuffer(mesh)) {
       this.ithacafv.readUnstructuredGrid(mesh);
     } else if (ArrayBuffer.isView(mesh)) {
@@ -529,6 +1000,40 @@ class ITHACAFVWrapper extends VTKFunctions {
     this.ithacafv.initScene();
   }
 
+  /**
+   * Exports the prepared mesh state: the grid with its fields, the cell
+   * centers and the boundary surface. The state is a versioned and
+   * checksummed binary blob that can be stored, e.g. in IndexedDB or on
+   * disk, and loaded with loadState in a later session.
+   *
+   * @example
+   * var state = model.exportState();
+   * @returns {Uint8Array} The state.
+   */
+  exportState() {
+    return super.exportState(this.ithacafv);
+  }
+
+  /**
+   * Loads a state written by exportState, replacing loadMesh. The grid
+   * arrays are used in place from the state. Locators are not part of the
+   * state and are built again on first use.
+   *
+   * @example
+   * model.loadState(state).then(() => {
+   *   ...
+   * });
+   * @param {TypedArray|ArrayBuffer} state - The state.
+   * @throws {Error} If the state is corrupted, written by another version
+   * or another model, in which case the mesh must be loaded with loadMesh.
+   */
+  async loadState(state) {
+    await this.init();
+    this.cache.clear();
+    super.restoreState(this.ithacafv, state);
+    this.ithacafv.initScene();
+  }
+
   /**
    * Loads an ITHACA-FV model with its matrices and related files bundled
    * in a ZIP files.
@@ -560,6 +1065,8 @@ class ITHACAFVWrapper extends VTKFunctions {
     else {
     }
 
+    this.clearCache();
+
     const zipFiles = await jszip.loadAsync(data);
 
     const K = await readFile(zipFiles, "K_mat.txt");
@@ -656,19 +1163,143 @@ class ITHACAFVWrapper extends VTKFunctions {
    * Solves the ROM online solution and Updates the fields in the loaded grid.
    * It also applies the operations defined in setOperations.
    *
+   * Solutions are memoized by (U, nu): revisiting cached parameters restores
+   * the fields without solving. See setCache and cacheStatistics.
+   *
    * @example
    * model.update({ nu: 1.0e-05, U: [10.0, 0.0] });
    * @param {Object} dict - The input dictionary.
    * @property {number} dict.nu - The domain viscosity
    * @property {number[]} dict.U - The inlet velocity. An array with two numbers
    * with the two coordinate values at the inlet.
+   * @property {boolean} [dict.preview] - If the parameters are not cached,
+   * interpolates the fields from the nearest cached solutions instead of
+   * solving, e.g. while dragging a slider. Update again without preview to
+   * get the solved fields.
    * @returns {void}
    */
   update(dict) {
+    const parameters = [dict.U[0], dict.U[1], dict.nu];
+    const key = parameters.join(',');
+    const cached = this.cache.get(key);
+
+    if (cached !== undefined) {
+      this.cache.delete(key);
+      this.cache.set(key, cached);
+      this.ithacafv.restoreFields(cached.slot);
+      this.cacheStats.hits++;
+      return;
+    }
+
+    if (dict.preview === true && this.cache.size > 0) {
+      this.previewFromCache(parameters);
+      this.cacheStats.previews++;
+      return;
+    }
+
+    const start = performance.now();
     this.ithacafv.setNu(dict.nu);
     this.ithacafv.solveOnline(dict.U[0], dict.U[1]);
     this.ithacafv.reconstruct();
     super.operations(this.ithacafv, this.operations);
+    this.cacheStats.solves++;
+    this.cacheStats.solveTime += performance.now() - start;
+
+    if (this.cacheSize > 0) {
+      while (this.cache.size >= this.cacheSize) {
+        const [oldest, entry] = this.cache.entries().next().value;
+        this.ithacafv.removeFields(entry.slot);
+        this.cache.delete(oldest);
+      }
+
+      const slot = this.cacheSlot++;
+      this.ithacafv.cacheFields(slot);
+      this.cache.set(key, { slot: slot, parameters: parameters });
+    }
+  }
+
+  /**
+   * Sets the size of the cache of solutions used by update. Solutions are
+   * cached by (U, nu) with the operations already applied, and the least
+   * recently used one is evicted when full. Each entry holds a copy of the
+   * grid fields.
+   *
+   * @example
+   * model.setCache({ size: 16 });
+   * @param {Object} dict - The input dictionary.
+   * @property {number} dict.size - The maximum number of cached solutions,
+   * 8 by default. 0 disables the cache.
+   * @returns {void}
+   */
+  setCache(dict) {
+    this.clearCache();
+    this.cacheSize = dict.size;
+  }
+
+  /**
+   * Gets the statistics of the cache of solutions used by update.
+   *
+   * @example
+   * var stats = model.cacheStatistics();
+   * @returns {{hits: number, previews: number, solves: number,
+   * hitRate: number, solveTime: number, averageSolveTime: number}} - The
+   * number of exact hits, interpolated previews and full solves, the hit
+   * rate over all updates, and the total and average solve times in ms.
+   */
+  cacheStatistics() {
+    const stats = this.cacheStats;
+    const updates = stats.hits + stats.previews + stats.solves;
+
+    return {
+      hits: stats.hits,
+      previews: stats.previews,
+      solves: stats.solves,
+      hitRate: updates > 0 ? stats.hits / updates : 0,
+      solveTime: stats.solveTime,
+      averageSolveTime: stats.solves > 0 ? stats.solveTime / stats.solves : 0
+    };
+  }
+
+  resetCacheStats() {
+    this.cacheStats = { hits: 0, previews: 0, solves: 0, solveTime: 0 };
+  }
+
+  clearCache() {
+    if (this.ithacafv) {
+      for (const entry of this.cache.values()) {
+        this.ithacafv.removeFields(entry.slot);
+      }
+    }
+
+    this.cache.clear();
+  }
+
+  // The reconstructed fields are linear in the reduced coefficients, so
+  // blending cached fields is the same as blending their coefficients.
+  previewFromCache(parameters) {
+    const distance = (a, b) => {
+      const U = Math.hypot(a[0] - b[0], a[1] - b[1]);
+      const UScale = Math.max(Math.hypot(a[0], a[1]), 1e-12);
+      const nuScale = Math.max(Math.abs(a[2]), 1e-12);
+      return U / UScale + Math.abs(a[2] - b[2]) / nuScale;
+    };
+
+    const nearest = Array.from(this.cache.values())
+      .map((entry) => ({
+        slot: entry.slot,
+        distance: distance(parameters, entry.parameters)
+      }))
+      .sort((a, b) => a.distance - b.distance)
+      .slice(0, 4);
+
+    const inverse = nearest.map((entry) =>
+      1 / Math.pow(Math.max(entry.distance, 1e-12), 2));
+    const total = inverse.reduce((sum, value) => sum + value, 0);
+
+    this.ithacafv.blendFields(
+      nearest.map((entry) => entry.slot),
+      inverse.map((value) => value / total)
+    );
   }
 
   /**
@@ -682,6 +1313,53 @@ class ITHACAFVWrapper extends VTKFunctions {
     return super.grid(this.ithacafv);
   }
 
+  /**
+   * Gets a compressed VTK XML file (.vtu for the grid, .vtp otherwise) as a
+   * byte array, written with the options set in setExportOptions.
+   *
+   * With delta enabled, and if the topology has not changed since the last
+   * delta export of the same target, the result is an empty .vtp holding
+   * only the arrays that changed as field data, named "PointData:<name>" or
+   * "CellData:<name>". A "RemovedArrays" string array lists the arrays
+   * that are no longer present. Otherwise the full file is returned, so the
+   * first delta export is the base file. Exports without delta reset it.
+   *
+   * @example
+   * model.setExportOptions({ mode: "appended", compressor: "lz4" });
+   * var base = model.exportData({ target: "grid", delta: true });
+   * model.update({ nu: 1.0e-05, U: [10.0, 0.0] });
+   * var delta = model.exportData({ target: "grid", delta: true });
+   * @param {Object} dict - The input dictionary.
+   * @property {string} dict.target - The data to export. Must be one of:
+   * - "grid" for the whole grid,
+   * - "surface" for the grid boundary, or
+   * - "component" for the active component.
+   * @property {boolean} [dict.delta] - Exports only the changed arrays.
+   * @returns {Uint8Array} The file data
+   */
+  exportData(dict) {
+    return super.exportData(this.ithacafv, dict);
+  }
+
+  /**
+   * Sets the writer options used by exportData.
+   *
+   * @example
+   * model.setExportOptions({ mode: "appended", compressor: "zlib", level: 9 });
+   * @param {Object} dict - The input dictionary.
+   * @property {string} [dict.mode] - The data mode, "ascii", "binary" (base64
+   * inline) or "appended" (raw binary, default).
+   * @property {string} [dict.compressor] - The compressor, "none", "zlib"
+   * (default), "lz4" or "lzma".
+   * @property {number} [dict.level] - The compression level from 1 (fastest)
+   * to 9 (smallest). Defaults to 5.
+   * @returns {void}
+   * @throws {Error} If an option is not one of the supported values.
+   */
+  setExportOptions(dict) {
+    super.setExportOptions(this.ithacafv, dict);
+  }
+
   /**
    * Gets the value of a given field at a given point.
    *
@@ -698,6 +1376,54 @@ class ITHACAFVWrapper extends VTKFunctions {
     return super.probe(this.ithacafv, dict);
   }
 
+  /**
+   * Seeds tracer particles for advect, uniformly in a sphere. Particles are
+   * respawned in the sphere when they leave the grid or their lifetime
+   * expires. Lifetimes are randomized between half and the full lifetime.
+   *
+   * @example
+   * model.setParticles({
+   *   count: 10000,
+   *   center: [0, 0, 0],
+   *   radius: 1.0,
+   *   lifetime: 5.0
+   * });
+   * @param {Object} dict - The input dictionary.
+   * @property {number} dict.count - The number of particles
+   * @property {number[]} dict.center - The center of the seeding sphere, an
+   * array with three numbers representing the x,y,z coordinates.
+   * @property {number} dict.radius - The radius of the seeding sphere
+   * @property {number} dict.lifetime - The maximum particle lifetime
+   * @returns {void}
+   * @throws {Error} If count is not a non-negative integer, or radius or
+   * lifetime is not positive.
+   */
+  setParticles(dict) {
+    super.setParticles(this.ithacafv, dict);
+  }
+
+  /**
+   * Advances the particles seeded with setParticles one time step through
+   * the current velocity field and returns their positions, e.g. for
+   * instanced rendering.
+   * - Particles track the cell containing them and move by walking through
+   *   neighbor cells, without a global search per step.
+   * - The returned array is a view of a buffer reused across steps. It is
+   *   only valid until the next call to the module.
+   *
+   * @example
+   * var positions = model.advect({ field: "U", dt: 0.01 });
+   * @param {Object} dict - The input dictionary.
+   * @property {string} dict.field - The velocity field
+   * @property {number} dict.dt - The time step
+   * @returns {Float32Array} The particle positions as x,y,z triplets
+   * @throws {Error} If the field is not a point or cell field with 3
+   * components.
+   */
+  advect(dict) {
+    return super.advect(this.ithacafv, dict);
+  }
+
   /**
    * Gets the integrated value of a given field for the whole domain or the
    * active component.
@@ -822,6 +1548,7 @@ class ITHACAFVWrapper extends VTKFunctions {
    * @returns {void}
    */
   setOperations(dict) {
+    this.clearCache();
     this.operations = [];
     for (var i = 0; i < dict.operations.length; i++) {
       switch (dict.operations[i]) {
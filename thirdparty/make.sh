@@ -2,7 +2,7 @@
 #!/bin/bash
 
 PROC=6
-ROOT=/build
+ROOT=${ROOT:-/build}
 BUILD_ROOT=$ROOT/thirdparty
 
 if [[ -v CORES && -n "${CORES}" ]]; then
@@ -28,7 +28,7 @@ cd $VTK_BUILD
 
 emcmake cmake \
   -GNinja \
-  -DCMAKE_TOOLCHAIN_FILE=${CMAKE_TOOLCHAIN_FILE} \
+  ${CMAKE_TOOLCHAIN_FILE:+-DCMAKE_TOOLCHAIN_FILE=${CMAKE_TOOLCHAIN_FILE}} \
   -DVTK_BUILD_DOCUMENTATION=NO \
   -DVTK_BUILD_TESTING=OFF \
   -DVTK_GROUP_ENABLE_Imaging=DONT_WANT \
@@ -55,3 +55,26 @@ emcmake cmake \
   ..
 
 cmake --build $VTK_BUILD --parallel $PROC
+
+if [[ "$WITH_ONNXRUNTIME" = "true" ]]; then
+  echo "#############################"
+  echo  BUILDING ONNX Runtime
+  echo "#############################"
+
+  ONNXRUNTIME_ROOT=$BUILD_ROOT/onnxruntime
+  ONNXRUNTIME_VERSION=v1.15.1
+
+  if [ ! -d $ONNXRUNTIME_ROOT  ];then
+    git clone --depth 1 --branch $ONNXRUNTIME_VERSION --recursive \
+      https://github.com/microsoft/onnxruntime.git $ONNXRUNTIME_ROOT
+  fi
+
+  cd $ONNXRUNTIME_ROOT
+
+  ./build.sh \
+    --config Release \
+    --build_wasm_static_lib \
+    --skip_tests \
+    --disable_rtti \
+    --parallel $PROC
+fi